@@ -0,0 +1,42 @@
+# superinstructions: first half of a fused pair that writes pc
+# must not be followed by its second half
+.data
+.word 0
+
+.text
+.global _start
+
+_start:
+# mov r7 + add: add is decoded first, then skipped over
+mov r1, 47
+mov r2, 0
+jmp skipped
+again:
+mov r7, &skip
+skipped:
+add r1, 1
+skip:
+add r2, 1
+cmp r2, 3
+jne again
+mov *0xFF00, r1		# 0
+
+# pop r7 + pop: second pop is decoded first, then skipped over
+mov r2, 0
+mov r4, 50
+push r4
+jmp skipped2
+again2:
+mov r3, &skip2
+push r3
+pop r7
+skipped2:
+pop r4
+skip2:
+add r2, 1
+cmp r2, 3
+jne again2
+mov *0xFF00, r4		# 2
+mov *0xFF00, 10
+halt
+.end
\ No newline at end of file
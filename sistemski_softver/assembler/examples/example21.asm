@@ -0,0 +1,40 @@
+# processor waiting for interrupts: wait instruction and jump to itself;
+# timer routine ends the program on its sixth tick
+.section iv_table
+.word init
+.word init
+.word tick
+.word init
+.skip 8
+
+.section handlers, "rx"
+init:
+mov r6, 0xFF00
+mov *0xFF10, 0		# timer_cfg
+halt
+
+tick:
+add ticks, 1
+cmp ticks, 6
+jne tick_end
+mov *0xFF00, 68		# D
+mov *0xFF00, 10
+halt
+tick_end:
+iret
+
+.data
+ticks: .word 0
+
+.text
+.global _start
+
+_start:
+wait_loop:
+wait
+cmp ticks, 3
+jne wait_loop
+mov *0xFF00, 87		# W
+idle:
+jmp idle
+.end
\ No newline at end of file
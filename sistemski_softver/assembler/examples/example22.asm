@@ -0,0 +1,78 @@
+# timer interrupt has to come after the same instruction on every engine, also when
+# it falls into a block compiled by jit; tick routine prints low bits of r1
+.section iv_table
+.word init
+.word init
+.word tick
+.word init
+.skip 8
+
+.section handlers, "rx"
+init:
+mov r6, 0xFF00
+mov *0xFF10, 0		# timer_cfg
+halt
+
+tick:
+push r0
+mov r0, r1
+and r0, 15
+add r0, 65			# A + (r1 & 15)
+mov *0xFF00, r0
+pop r0
+add ticks, 1
+cmp ticks, 12
+jne tick_end
+mov *0xFF00, 10
+halt
+tick_end:
+iret
+
+.data
+ticks: .word 0
+
+.text
+.global _start
+
+_start:
+mov r1, 0
+spin:
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+add r1, 1
+jmp spin
+.end
\ No newline at end of file
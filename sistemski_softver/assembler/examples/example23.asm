@@ -0,0 +1,84 @@
+# devices: semihost prints a span of memory, dma copies and fills it, storage reads
+# a sector of the disk image (this file itself) into it; both can end with an interrupt
+.data
+msg: .byte 100, 101, 118, 105, 99, 101, 115, 10
+digits: .byte 48, 97, 49, 98, 50, 99, 51, 100
+count: .word 0
+buf: .skip 512
+
+.text
+.global _start
+
+_start:
+mov *8, &dma_done			# ivt entry 4 - dma
+mov *10, &storage_done		# ivt entry 5 - storage
+
+# semihost
+mov *0xFF20, &msg
+mov *0xFF22, 8
+movb *0xFF24, 1
+
+# dma copy
+mov *0xFF30, &msg
+mov *0xFF32, &buf
+mov *0xFF34, 7
+movb *0xFF38, 1
+call print_buf
+
+# dma fill
+mov *0xFF30, 42				# *
+mov *0xFF32, &buf
+mov *0xFF34, 4
+movb *0xFF38, 2
+call print_buf
+
+# dma copy of every second byte, with interrupt
+mov *0xFF30, &digits
+mov *0xFF32, &buf
+mov *0xFF34, 4
+mov *0xFF36, 2
+movb *0xFF38, 0x83
+wait
+call print_buf
+
+# storage, sector 0 with interrupt; status is printed before the data
+mov *0xFF40, 0
+mov *0xFF42, &buf
+movb *0xFF44, 0x81
+wait
+mov r0, *0xFF46
+add r0, 48
+mov *0xFF00, r0
+call print_buf
+
+# storage, sector past the end of image
+mov *0xFF40, 1000
+mov *0xFF42, &buf
+movb *0xFF44, 1
+mov r0, *0xFF46
+add r0, 48
+mov *0xFF00, r0
+mov *0xFF00, 10
+
+# interrupts served
+mov r0, count
+add r0, 48
+mov *0xFF00, r0
+mov *0xFF00, 10
+halt
+
+print_buf:
+mov *0xFF20, &buf
+mov *0xFF22, 7
+movb *0xFF24, 1
+mov *0xFF00, 10
+ret
+
+dma_done:
+add count, 1
+iret
+
+storage_done:
+add count, 1
+iret
+.end
\ No newline at end of file
@@ -0,0 +1,23 @@
+# checkpoint and resume: program prints ten digits with a delay between them; run that
+# is stopped by budget and resumed from its checkpoint prints the same as a whole run
+.data
+digit: .word 48				# 0
+
+.text
+.global _start
+
+_start:
+next_digit:
+mov r0, digit
+mov *0xFF00, r0
+mov r1, 1000
+delay:
+sub r1, 1
+cmp r1, 0
+jne delay
+add digit, 1
+cmp digit, 58				# past 9
+jne next_digit
+mov *0xFF00, 10
+halt
+.end
\ No newline at end of file
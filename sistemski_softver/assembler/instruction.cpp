@@ -8,7 +8,7 @@ Instruction::Instruction(const Token& instruction, queue<Token> params, unsigned
 	OperandSize operandSize = OperandSize::WORD;
 	string instructionMnemonic = instruction.GetValue();
 	// second condition because mnemonic can end with 'b' (e.g. sub)
-	if ((instructionMnemonic[instructionMnemonic.size() - 1] == 'b') && (instructionOperandMap.find(instructionMnemonic) == instructionOperandMap.end()))
+	if ((instructionMnemonic[instructionMnemonic.size() - 1] == 'b') && (ISALookupMnemonic(instructionMnemonic) == -1))
 	{
 		operandSize = OperandSize::BYTE;
 		instructionMnemonic = instructionMnemonic.substr(0, instructionMnemonic.size() - 1);
@@ -16,14 +16,14 @@ Instruction::Instruction(const Token& instruction, queue<Token> params, unsigned
 	else if (instructionMnemonic[instructionMnemonic.size() - 1] == 'w')
 		instructionMnemonic = instructionMnemonic.substr(0, instructionMnemonic.size() - 1);
 
-	map<string, InstructionDetails>::iterator it = instructionOperandMap.find(instructionMnemonic);
+	int code = ISALookupMnemonic(instructionMnemonic);
 
-	if (it == instructionOperandMap.end())
+	if (code == -1)
 		throw AssemblerException("Instruction '" + instruction.GetValue() + "' is not recognized.", ErrorCodes::INVALID_INSTRUCTION, lineNumber);
-	else if (instructionOperandMap.at(instructionMnemonic).numberOfOperands != params.size())
+	else if (isaTable[code].numberOfOperands != params.size())
 		throw AssemblerException("Instruction '" + instruction.GetValue() + "' number of operands is not satisfied.", ErrorCodes::INVALID_OPERAND, lineNumber);
 
-	operationCode[0] = instructionOperandMap.at(instructionMnemonic).opCode << 3;
+	operationCode[0] = code << 3;
 	operationCode[0] = operationCode[0] | (operandSize << 2);
 	instructionSize++;
 
@@ -371,7 +371,7 @@ int Instruction::GetInstructionSize(const Token& instruction, queue<Token> param
 	OperandSize operandSize = OperandSize::WORD;
 	string instructionMnemonic = instruction.GetValue();
 	// second condition because mnemonic can end with 'b' (e.g. sub)
-	if ((instructionMnemonic[instructionMnemonic.size() - 1] == 'b') && (instructionOperandMap.find(instructionMnemonic) == instructionOperandMap.end()))
+	if ((instructionMnemonic[instructionMnemonic.size() - 1] == 'b') && (ISALookupMnemonic(instructionMnemonic) == -1))
 	{
 		operandSize = OperandSize::BYTE;
 		instructionMnemonic = instructionMnemonic.substr(0, instructionMnemonic.size() - 1);
@@ -379,11 +379,11 @@ int Instruction::GetInstructionSize(const Token& instruction, queue<Token> param
 	else if (instructionMnemonic[instructionMnemonic.size() - 1] == 'w')
 		instructionMnemonic = instructionMnemonic.substr(0, instructionMnemonic.size() - 1);
 
-	map<string, InstructionDetails>::iterator it = instructionOperandMap.find(instructionMnemonic);
+	int code = ISALookupMnemonic(instructionMnemonic);
 
-	if (it == instructionOperandMap.end())
+	if (code == -1)
 		throw AssemblerException("Instruction '" + instruction.GetValue() + "' is not recognized.", ErrorCodes::INVALID_INSTRUCTION, lineNumber);
-	else if (instructionOperandMap.at(instructionMnemonic).numberOfOperands != params.size())
+	else if (isaTable[code].numberOfOperands != params.size())
 		throw AssemblerException("Instruction '" + instruction.GetValue() + "' number of operands is not satisfied.", ErrorCodes::INVALID_OPERAND, lineNumber);
 
 	int iteration = static_cast<int>(params.size());
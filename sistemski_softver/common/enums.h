@@ -60,7 +60,9 @@ enum InterruptType : int
 	RESET = 0,
 	INT_INVALID_INSTRUCTION = 1,
 	TIMER = 2,
-	KEYBOARD = 3
+	KEYBOARD = 3,
+	DMA = 4,
+	STORAGE = 5
 };
 
 #endif
\ No newline at end of file
@@ -46,7 +46,11 @@ enum ErrorCodes
 	EMULATOR_SEGMENTATION_FAULT,
 	EMULATOR_NON_EXECUTABLE_SECTION,
 	EMULATOR_STACK_UNDERFLOW,
-	EMULATOR_SECTION_MISSING
+	EMULATOR_SECTION_MISSING,
+	EMULATOR_INVALID_FUSION_TABLE,
+	EMULATOR_EVENT_LOOP,
+	EMULATOR_FARM_MANIFEST,
+	EMULATOR_CHECKPOINT
 };
 
 class AssemblerException : public exception
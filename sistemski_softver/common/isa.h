@@ -0,0 +1,157 @@
+#ifndef _ISA_COMMON_H
+#define _ISA_COMMON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// operation code occupies 5 bits of instruction descriptor
+#define ISA_NUMBER_OF_CODES 32
+#define ISA_MNEMONIC_HASH_SIZE 64
+
+// DO NOT CHANGE THE ORDER HERE
+enum InstructionMnemonic
+{
+	HALT = 1,
+	XCHG,
+	INT,
+	MOV,
+	ADD,
+	SUB,
+	MUL,
+	DIV,
+	CMP,
+	NOT,
+	AND,
+	OR,
+	XOR,
+	TEST,
+	SHL,
+	SHR,
+	PUSH,
+	POP,
+	JMP,
+	JEQ,
+	JNE,
+	JGT,
+	CALL,
+	RET,
+	IRET,
+	WAIT
+};
+
+struct ISAInstruction
+{
+	const char* mnemonic;
+	uint8_t numberOfOperands;
+	// assembler accepts 'b' or 'w' operand size suffix
+	bool sized;
+};
+
+// indexed by operation code; unused codes have no mnemonic
+static constexpr ISAInstruction isaTable[ISA_NUMBER_OF_CODES] = {
+	{ 0, 0, false },
+	{ "halt", 0, false },
+	{ "xchg", 2, true },
+	{ "int", 1, false },
+	{ "mov", 2, true },
+	{ "add", 2, true },
+	{ "sub", 2, true },
+	{ "mul", 2, true },
+	{ "div", 2, true },
+	{ "cmp", 2, true },
+	{ "not", 1, true },
+	{ "and", 2, true },
+	{ "or", 2, true },
+	{ "xor", 2, true },
+	{ "test", 2, true },
+	{ "shl", 2, true },
+	{ "shr", 2, true },
+	{ "push", 1, true },
+	{ "pop", 1, true },
+	{ "jmp", 1, false },
+	{ "jeq", 1, false },
+	{ "jne", 1, false },
+	{ "jgt", 1, false },
+	{ "call", 1, false },
+	{ "ret", 0, false },
+	{ "iret", 0, false },
+	{ "wait", 0, false },
+	{ 0, 0, false }, { 0, 0, false }, { 0, 0, false }, { 0, 0, false }, { 0, 0, false }
+};
+
+// mnemonics are at least two characters long
+constexpr size_t ISAMnemonicHash(const char* mnemonic, size_t length)
+{
+	return (mnemonic[0] * 3 + mnemonic[1] * 5 + mnemonic[length - 1] * 7 + length) & (ISA_MNEMONIC_HASH_SIZE - 1);
+}
+
+constexpr size_t ISAMnemonicLength(const char* mnemonic)
+{
+	size_t length = 0;
+	while (mnemonic[length])
+		length++;
+
+	return length;
+}
+
+struct ISAMnemonicTable
+{
+	// operation code for each hash value, 0 if none
+	uint8_t codes[ISA_MNEMONIC_HASH_SIZE];
+	bool perfect;
+};
+
+constexpr ISAMnemonicTable MakeISAMnemonicTable()
+{
+	ISAMnemonicTable table = {};
+	table.perfect = true;
+
+	for (uint8_t code = 0; code < ISA_NUMBER_OF_CODES; code++)
+	{
+		if (!isaTable[code].mnemonic)
+			continue;
+
+		size_t slot = ISAMnemonicHash(isaTable[code].mnemonic, ISAMnemonicLength(isaTable[code].mnemonic));
+		if (table.codes[slot] != 0)
+			table.perfect = false;
+		table.codes[slot] = code;
+	}
+
+	return table;
+}
+
+static constexpr ISAMnemonicTable isaMnemonicTable = MakeISAMnemonicTable();
+static_assert(isaMnemonicTable.perfect, "ISA mnemonic hash has collisions, change ISAMnemonicHash.");
+
+// operation code of given mnemonic (without size suffix), -1 if there is no such instruction
+inline int ISALookupMnemonic(const string& mnemonic)
+{
+	if (mnemonic.size() < 2)
+		return -1;
+
+	uint8_t code = isaMnemonicTable.codes[ISAMnemonicHash(mnemonic.c_str(), mnemonic.size())];
+	if (code == 0 || mnemonic != isaTable[code].mnemonic)
+		return -1;
+
+	return code;
+}
+
+// pattern tokenizer uses to recognize instructions
+inline string ISAInstructionPattern()
+{
+	string plain, sized;
+	for (uint8_t code = 0; code < ISA_NUMBER_OF_CODES; code++)
+	{
+		if (!isaTable[code].mnemonic)
+			continue;
+
+		string& list = isaTable[code].sized ? sized : plain;
+		list += (list.empty() ? "" : "|") + string(isaTable[code].mnemonic);
+	}
+
+	return "^(" + plain + "|(" + sized + ")(b|w){0,1})$";
+}
+
+#endif
\ No newline at end of file
@@ -180,16 +180,6 @@ public:
 	static RelocationTable Deserialize(size_t numberOfElements, ifstream& input);
 };
 
-struct InstructionDetails
-{
-	uint8_t numberOfOperands;
-	uint8_t opCode;
-	//bool jumpInstruction;
-
-	InstructionDetails(uint8_t numberOfOperands, uint8_t opCode) :
-		numberOfOperands(numberOfOperands), opCode(opCode) {}
-};
-
 struct TNSEntry
 {
 	string name;
@@ -7,6 +7,7 @@
 #include <regex>
 #include <string>
 #include "enums.h"
+#include "isa.h"
 #include "structures.h"
 
 static const regex staticAssemblyParsers[NUMBER_OF_PARSERS] = {
@@ -14,7 +15,7 @@ static const regex staticAssemblyParsers[NUMBER_OF_PARSERS] = {
 	regex("^([a-zA-Z_][a-zA-Z0-9_]*_{0,}):$"),	// label (contains ':' on end; symbol is without ':')
 	regex("^\\.(data|text|bss|section)$"),		// section
 	regex("^\\.(align|byte|equ|skip|word)$"),	// directive
-	regex("^(halt|ret|iret|int|jmp|jeq|jne|jgt|call|(not|push|pop|xchg|mov|add|sub|mul|div|cmp|and|or|xor|test|shl|shr)(b|w){0,1})$"),
+	regex(ISAInstructionPattern()),				// instruction
 	regex("^r[0-9]+(h|l){0,1}$"),				// register direct addressing
 	regex("^.end$"),							// end of file
 	regex("^(\\-|\\+){0,1}[0-9]+$"),			// operand intermediate decimal
@@ -0,0 +1,82 @@
+#include "aot.h"
+#include "emulator.h"
+#include <cstring>
+
+AOTRuntime::AOTRuntime(CPU& processor, const AOTProgram& program) : processor(processor), program(program), registers(processor.registerFile)
+{
+	for (size_t i = 0; i < program.numberOfBlocks; i++)
+	{
+		const AOTBlock& block = program.blocks[i];
+		for (uint32_t page = block.startPC / AOT_PAGE_SIZE; page <= (block.endPC - 1) / AOT_PAGE_SIZE; page++)
+			pageBlocks[page].push_back(i);
+	}
+}
+
+void AOTRuntime::Run()
+{
+	while (!processor.halted)
+	{
+		// pending invalid instruction interrupt changes how the next instruction behaves, leave it to interpreter
+		if (!disabled[processor.pc] && !processor.interrupts.IsPending(InterruptType::INT_INVALID_INSTRUCTION) &&
+			program.execute(*this))
+		{
+			processor.InstructionHandleInterrupt();
+			continue;
+		}
+
+		processor.InstructionFetchAndDecode();
+		processor.InstructionExecuteSpecialized();
+		processor.InstructionHandleInterrupt();
+	}
+}
+
+void AOTRuntime::Invalidate(const uint16_t& address)
+{
+	const vector<size_t>& blocks = pageBlocks[address / AOT_PAGE_SIZE];
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		const AOTBlock& block = program.blocks[blocks[i]];
+		if (block.startPC <= address && address < block.endPC)
+			disabled[block.startPC] = true;
+	}
+}
+
+Executable* AOTRuntime::CreateExecutable(const AOTProgram& program)
+{
+	LinkerSections sections;
+	for (size_t i = 0; i < program.numberOfSections; i++)
+		sections.insert({ program.sections[i].name, program.sections[i].start });
+
+	Executable* executable = new Executable(sections);
+	memcpy(executable->memory, program.image, MEMORY_ADDRESS_SPACE);
+	for (size_t i = 0; i < program.numberOfSections; i++)
+		executable->sectionTable->InsertSection(SectionTableEntry(program.sections[i].name, program.sections[i].length, i, program.sections[i].flags));
+
+	executable->initialPC = program.initialPC;
+	executable->initialPCDefined = true;
+	executable->BuildPermissionTable();
+
+	return executable;
+}
+
+int AOTRuntime::Main(const AOTProgram& program)
+{
+	try
+	{
+		Emulator emulator(CreateExecutable(program));
+		emulator.UseAOTProgram(program);
+		emulator.Start();
+	}
+	catch (const EmulatorException& ex)
+	{
+		cout << ex << endl;
+	}
+	catch (const exception& ex)
+	{
+		cout << "Unknown emulator error: " << endl;
+		cout << ex.what() << endl;
+		cout << endl;
+	}
+
+	return 1;
+}
\ No newline at end of file
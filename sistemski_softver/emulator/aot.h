@@ -0,0 +1,94 @@
+#ifndef _AOT_EMULATOR_H
+#define _AOT_EMULATOR_H
+
+#include "cpu.h"
+#include "executable.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+#define AOT_PAGE_SIZE 256
+
+// placement of a section of the image embedded into translated program
+struct AOTSection
+{
+	const char* name;
+	uint16_t start;
+	uint32_t length;
+	uint8_t flags;
+};
+
+// guest code compiled into one case of the translated program
+struct AOTBlock
+{
+	uint16_t startPC;
+	// address after last translated instruction
+	uint32_t endPC;
+};
+
+class AOTRuntime;
+// runs block starting at current pc; false if program has no block there
+typedef bool (*AOTBlockFunction)(AOTRuntime& runtime);
+
+// everything translator emits about the program
+struct AOTProgram
+{
+	const uint8_t* image;
+	const AOTSection* sections;
+	size_t numberOfSections;
+	uint16_t initialPC;
+
+	const AOTBlock* blocks;
+	size_t numberOfBlocks;
+	AOTBlockFunction execute;
+};
+
+class AOTRuntime
+{
+
+private:
+	CPU& processor;
+	const AOTProgram& program;
+
+	// blocks whose guest code was overwritten after translation are left to interpreter
+	bool disabled[MEMORY_ADDRESS_SPACE] = {};
+	// indices of blocks covering each page
+	vector<size_t> pageBlocks[MEMORY_ADDRESS_SPACE / AOT_PAGE_SIZE];
+
+public:
+	uint16_t* const registers;
+
+	AOTRuntime(CPU& processor, const AOTProgram& program);
+
+	// runs processor until it halts, executing compiled blocks where possible
+	void Run();
+	void Invalidate(const uint16_t& address);
+
+	static Executable* CreateExecutable(const AOTProgram& program);
+	// entry point of translated program
+	static int Main(const AOTProgram& program);
+
+	// used by generated code, same semantics interpreter has
+	inline uint16_t PC() { return processor.pc; }
+	inline void Jump(uint16_t pc) { processor.pc = pc; }
+	// false if a deadline falls within the block, interpreter steps up to it instead
+	inline bool BeforeDeadline(uint16_t numberOfInstructions) { return processor.instructionCount + numberOfInstructions <= processor.deviceDeadline; }
+	inline void Executed(uint16_t numberOfInstructions) { processor.instructionCount += numberOfInstructions; }
+	inline uint16_t Load16(uint16_t address)
+	{
+		// sources known to be device registers are not translated, but indirect ones are found out only here
+		if (address >= MEMORY_MAPPED_REGISTERS_START)
+			processor.devices.Read(processor, address);
+		return *((const uint16_t*)(&processor.memory_read(address)));
+	}
+
+	inline void FlagsZN(int16_t result) { processor.DeferFlagsZN(result); }
+	inline void FlagO(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation) { processor.DeferFlagO(src, dst, r, operation); }
+	inline void FlagC(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation) { processor.DeferFlagC(src, dst, r, operation); }
+	inline bool Z() { return processor.GetZ(); }
+	inline bool N() { return processor.GetN(); }
+	inline bool O() { return processor.GetO(); }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "checkpoint.h"
+#include "cpu.h"
+#include "mappedfile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+string Checkpoint::SerializeSections(const Executable& executable)
+{
+	string sections;
+
+	LinkerSections::const_iterator it;
+	for (it = executable.sectionStartMap.begin(); it != executable.sectionStartMap.end(); it++)
+	{
+		const SectionTableEntry* entry = executable.sectionTable->GetEntryByName(it->first);
+		if (!entry)
+			continue;
+
+		CheckpointSection section = {};
+		section.start = it->second;
+		section.nameLength = (uint16_t)it->first.size();
+		section.length = (uint32_t)entry->length;
+		section.flags = entry->flags;
+
+		sections.append((const char*)&section, sizeof(section));
+		sections.append(it->first);
+	}
+
+	return sections;
+}
+
+bool Checkpoint::Write(const string& fileName, const string& sections, uint16_t initialPC, const Snapshot& snapshot)
+{
+	CheckpointHeader header = {};
+	header.magic = CHECKPOINT_MAGIC;
+	header.version = CHECKPOINT_VERSION;
+	header.stateSize = sizeof(CheckpointState);
+
+	for (size_t offset = 0; offset < sections.size(); header.numberOfSections++)
+	{
+		CheckpointSection section;
+		memcpy(&section, sections.data() + offset, sizeof(section));
+		offset += sizeof(section) + section.nameLength;
+	}
+
+	static const uint8_t zeros[CHECKPOINT_PAGE_SIZE] = {};
+	for (uint32_t page = 0; page < CHECKPOINT_NUMBER_OF_PAGES; page++)
+	{
+		if (memcmp(snapshot.memory + page * CHECKPOINT_PAGE_SIZE, zeros, CHECKPOINT_PAGE_SIZE) == 0)
+			continue;
+
+		header.storedPages[page / 8] |= 1 << (page % 8);
+		header.numberOfPages++;
+	}
+
+	CheckpointState state = {};
+	state.instructionCount = snapshot.instructionCount;
+	state.timerDeadline = snapshot.timerDeadline;
+	state.inputDeadline = snapshot.inputDeadline;
+	state.budgetDeadline = snapshot.budgetDeadline;
+	memcpy(state.registerFile, snapshot.registerFile, sizeof(state.registerFile));
+	state.psw = snapshot.psw;
+	state.initialPC = initialPC;
+	state.pendingInterrupts = snapshot.pendingInterrupts;
+	state.timerConfiguration = snapshot.timerConfiguration;
+	state.halted = snapshot.halted;
+	state.initializationFinished = snapshot.initializationFinished;
+	state.budgetExhausted = snapshot.budgetExhausted;
+
+	string temporaryName = fileName + ".tmp";
+	ofstream output(temporaryName, ios::out | ios::binary | ios::trunc);
+	if (!output)
+		return false;
+
+	output.write((const char*)&header, sizeof(header));
+	output.write((const char*)&state, sizeof(state));
+	output.write(sections.data(), sections.size());
+	for (uint32_t page = 0; page < CHECKPOINT_NUMBER_OF_PAGES; page++)
+	{
+		if (header.storedPages[page / 8] & (1 << (page % 8)))
+			output.write((const char*)snapshot.memory + page * CHECKPOINT_PAGE_SIZE, CHECKPOINT_PAGE_SIZE);
+	}
+	output.close();
+
+	if (!output)
+	{
+		remove(temporaryName.c_str());
+		return false;
+	}
+
+	if (rename(temporaryName.c_str(), fileName.c_str()) != 0)
+	{
+		remove(fileName.c_str());
+		return rename(temporaryName.c_str(), fileName.c_str()) == 0;
+	}
+
+	return true;
+}
+
+Executable* Checkpoint::Load(const string& fileName, Snapshot& snapshot)
+{
+	MappedFile file;
+	if (!file.Open(fileName))
+		throw EmulatorException("Cannot open checkpoint file '" + fileName + "'.", ErrorCodes::IO_INPUT_EXCEPTION);
+
+	const uint8_t* data = file.Data();
+	const uint8_t* end = file.Data() + file.Size();
+
+	CheckpointHeader header;
+	CheckpointState state;
+	if (file.Size() < sizeof(header) + sizeof(state))
+		throw EmulatorException("Checkpoint file '" + fileName + "' is damaged.", ErrorCodes::EMULATOR_CHECKPOINT);
+	memcpy(&header, data, sizeof(header));
+	data += sizeof(header);
+
+	if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION || header.stateSize != sizeof(CheckpointState))
+		throw EmulatorException("File '" + fileName + "' is not a checkpoint of this emulator version.", ErrorCodes::EMULATOR_CHECKPOINT);
+	memcpy(&state, data, sizeof(state));
+	data += sizeof(state);
+
+	LinkerSections sectionStartMap;
+	vector<SectionTableEntry> sectionEntries;
+	for (uint16_t i = 0; i < header.numberOfSections; i++)
+	{
+		CheckpointSection section;
+		if (end - data < (ptrdiff_t)sizeof(section))
+			throw EmulatorException("Checkpoint file '" + fileName + "' is damaged.", ErrorCodes::EMULATOR_CHECKPOINT);
+		memcpy(&section, data, sizeof(section));
+		data += sizeof(section);
+
+		if (end - data < (ptrdiff_t)section.nameLength)
+			throw EmulatorException("Checkpoint file '" + fileName + "' is damaged.", ErrorCodes::EMULATOR_CHECKPOINT);
+		string name((const char*)data, section.nameLength);
+		data += section.nameLength;
+
+		sectionStartMap.insert({ name, section.start });
+		sectionEntries.push_back(SectionTableEntry(name, section.length, i, section.flags));
+	}
+
+	if (end - data != (ptrdiff_t)header.numberOfPages * CHECKPOINT_PAGE_SIZE)
+		throw EmulatorException("Checkpoint file '" + fileName + "' is damaged.", ErrorCodes::EMULATOR_CHECKPOINT);
+
+	memset(snapshot.memory, 0, MEMORY_ADDRESS_SPACE);
+	for (uint32_t page = 0; page < CHECKPOINT_NUMBER_OF_PAGES; page++)
+	{
+		if (!(header.storedPages[page / 8] & (1 << (page % 8))))
+			continue;
+
+		memcpy(snapshot.memory + page * CHECKPOINT_PAGE_SIZE, data, CHECKPOINT_PAGE_SIZE);
+		data += CHECKPOINT_PAGE_SIZE;
+	}
+
+	snapshot.generation = 0;
+	memcpy(snapshot.registerFile, state.registerFile, sizeof(snapshot.registerFile));
+	snapshot.psw = state.psw;
+	snapshot.halted = state.halted != 0;
+	snapshot.initializationFinished = state.initializationFinished != 0;
+	snapshot.pendingInterrupts = state.pendingInterrupts;
+	snapshot.timerConfiguration = state.timerConfiguration;
+	snapshot.instructionCount = state.instructionCount;
+	snapshot.timerDeadline = state.timerDeadline;
+	snapshot.inputDeadline = state.inputDeadline;
+	snapshot.budgetDeadline = state.budgetDeadline;
+	snapshot.budgetExhausted = state.budgetExhausted != 0;
+
+	Executable* executable = new Executable(sectionStartMap);
+	memcpy(executable->memory, snapshot.memory, MEMORY_ADDRESS_SPACE);
+	for (size_t i = 0; i < sectionEntries.size(); i++)
+		executable->sectionTable->InsertSection(sectionEntries[i]);
+	executable->initialPC = state.initialPC;
+	executable->initialPCDefined = true;
+	executable->BuildPermissionTable();
+
+	return executable;
+}
+
+CheckpointWriter::CheckpointWriter(const string& fileName, Executable& executable) : fileName(fileName),
+	sections(Checkpoint::SerializeSections(executable)), initialPC(executable.InitialPC())
+{
+	pending = new Snapshot();
+	writing = new Snapshot();
+	writerThread = new thread(&CheckpointWriter::Work, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stop = true;
+	}
+	wakeUp.notify_one();
+
+	writerThread->join();
+	delete writerThread;
+	delete pending;
+	delete writing;
+}
+
+void CheckpointWriter::Submit(CPU& processor)
+{
+	{
+		lock_guard<mutex> guard(lock);
+		processor.SaveState(*pending, false);
+		hasPending = true;
+	}
+	wakeUp.notify_one();
+}
+
+void CheckpointWriter::Work()
+{
+	unique_lock<mutex> guard(lock);
+	while (true)
+	{
+		wakeUp.wait(guard, [this] { return hasPending || stop; });
+		if (!hasPending)
+			break;
+
+		// processor fills the other buffer while this one is written
+		swap(pending, writing);
+		hasPending = false;
+
+		guard.unlock();
+		Checkpoint::Write(fileName, sections, initialPC, *writing);
+		guard.lock();
+	}
+}
\ No newline at end of file
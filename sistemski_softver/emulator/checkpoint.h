@@ -0,0 +1,105 @@
+#ifndef _CHECKPOINT_EMULATOR_H
+#define _CHECKPOINT_EMULATOR_H
+
+#include "executable.h"
+#include "snapshot.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+using namespace std;
+
+// "EMCP" read as little endian word
+#define CHECKPOINT_MAGIC 0x50434D45
+// has to be increased whenever layout of the file or meaning of its fields changes
+#define CHECKPOINT_VERSION 1
+// memory is stored in pages, pages holding nothing but zeros are left out
+#define CHECKPOINT_PAGE_SIZE 256
+#define CHECKPOINT_NUMBER_OF_PAGES (MEMORY_ADDRESS_SPACE / CHECKPOINT_PAGE_SIZE)
+#define CHECKPOINT_DEFAULT_INTERVAL 100000000
+
+class CPU;
+
+struct CheckpointHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t stateSize;
+	uint16_t numberOfSections;
+	uint16_t numberOfPages;
+	// bit per page, set if page is stored
+	uint8_t storedPages[CHECKPOINT_NUMBER_OF_PAGES / 8];
+};
+
+struct CheckpointState
+{
+	uint64_t instructionCount;
+	uint64_t timerDeadline;
+	uint64_t inputDeadline;
+	uint64_t budgetDeadline;
+	uint16_t registerFile[8];
+	uint16_t psw;
+	uint16_t initialPC;
+	uint8_t pendingInterrupts;
+	uint8_t timerConfiguration;
+	uint8_t halted;
+	uint8_t initializationFinished;
+	uint8_t budgetExhausted;
+	uint8_t reserved[3];
+};
+
+// followed by nameLength characters of section name
+struct CheckpointSection
+{
+	uint16_t start;
+	uint16_t nameLength;
+	uint32_t length;
+	uint8_t flags;
+	uint8_t reserved[3];
+};
+
+// file layout: header, state, sections, stored pages in address order; it holds
+// everything needed to continue the run, so neither object files nor linker are needed
+class Checkpoint
+{
+
+public:
+	// written aside and renamed, so a crash while writing leaves previous checkpoint intact
+	static bool Write(const string& fileName, const string& sections, uint16_t initialPC, const Snapshot& snapshot);
+	// serialized sections of executable, written unchanged into every checkpoint
+	static string SerializeSections(const Executable& executable);
+	// builds executable checkpoint was taken from and fills snapshot to restore into it
+	static Executable* Load(const string& fileName, Snapshot& snapshot);
+};
+
+// writes checkpoints on its own thread; processor only copies its state into
+// a spare snapshot, and a checkpoint that is not written yet is replaced by a newer one
+class CheckpointWriter
+{
+
+private:
+	string fileName;
+	string sections;
+	uint16_t initialPC;
+
+	Snapshot* pending;
+	Snapshot* writing;
+	bool hasPending = false;
+	bool stop = false;
+	mutex lock;
+	condition_variable wakeUp;
+	thread* writerThread = 0;
+
+	void Work();
+
+public:
+	CheckpointWriter(const string& fileName, Executable& executable);
+	// last submitted checkpoint is written before writer stops
+	~CheckpointWriter();
+
+	// has to be called at an instruction boundary, from thread that runs processor
+	void Submit(CPU& processor);
+};
+
+#endif
\ No newline at end of file
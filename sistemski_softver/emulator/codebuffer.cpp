@@ -0,0 +1,29 @@
+#include "codebuffer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+uint8_t* AllocateCodeBuffer(size_t size)
+{
+#ifdef _WIN32
+	return (uint8_t*)VirtualAlloc(0, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+	void* buffer = mmap(0, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return (buffer == MAP_FAILED ? 0 : (uint8_t*)buffer);
+#endif
+}
+
+void FreeCodeBuffer(uint8_t* buffer, size_t size)
+{
+	if (!buffer)
+		return;
+
+#ifdef _WIN32
+	VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+	munmap(buffer, size);
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef _CODEBUFFER_EMULATOR_H
+#define _CODEBUFFER_EMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+// memory that is readable, writable and executable; kept apart from the rest of
+// the emulator because platform headers clash with instruction mnemonics (INT)
+uint8_t* AllocateCodeBuffer(size_t size);
+void FreeCodeBuffer(uint8_t* buffer, size_t size);
+
+#endif
\ No newline at end of file
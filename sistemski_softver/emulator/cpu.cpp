@@ -1,4 +1,6 @@
 #include "cpu.h"
+#include "checkpoint.h"
+#include "jit.h"
 
 const uint16_t CPU::memory_read_16(const uint16_t & address)
 {
@@ -9,8 +11,11 @@ const uint16_t CPU::memory_read_16(const uint16_t & address)
 
 void CPU::ResolveAddressing(uint8_t rawData, Operand op)
 {
-	if (interruptRequests.size() != 0 && interruptRequests.top() == InterruptType::INT_INVALID_INSTRUCTION)
+	if (interrupts.IsPending(InterruptType::INT_INVALID_INSTRUCTION))
+	{
+		decodeCacheable = false;
 		return;
+	}
 
 	uint16_t& operand = (op == Operand::FIRST_OPERAND ? operand1 : operand2);
 	ByteSelector& byteSelector = (op == Operand::FIRST_OPERAND ? operand1ByteSelector : operand2ByteSelector);
@@ -60,6 +65,7 @@ void CPU::ResolveAddressing(uint8_t rawData, Operand op)
 		break;
 	}
 	default:
+		decodeCacheable = false;
 		SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
 		break;
 		//throw EmulatorException("Unknown addressing type.", ErrorCodes::EMULATOR_UNKNOWN_ADDRESSING);
@@ -71,6 +77,40 @@ void CPU::ResolveAddressing(uint8_t rawData, Operand op)
 		operand2AddressingType = addressingType;
 }
 
+void CPU::LoadDecodedOperand(const DecodedInstruction& decoded, Operand op)
+{
+	AddressingType addressingType = (op == Operand::FIRST_OPERAND ? decoded.operand1AddressingType : decoded.operand2AddressingType);
+	uint16_t& operand = (op == Operand::FIRST_OPERAND ? operand1 : operand2);
+	ByteSelector& byteSelector = (op == Operand::FIRST_OPERAND ? operand1ByteSelector : operand2ByteSelector);
+	uint8_t& registerSelector = (op == Operand::FIRST_OPERAND ? registerSelector1 : registerSelector2);
+
+	// only fields written by ResolveAddressing are restored, the others keep their previous values
+	switch (addressingType)
+	{
+	case AddressingType::IMMEDIATELY:
+	case AddressingType::MEMORY_DIRECT:
+		operand = (op == Operand::FIRST_OPERAND ? decoded.operand1 : decoded.operand2);
+		break;
+	case AddressingType::REGISTER_DIRECT:
+		registerSelector = (op == Operand::FIRST_OPERAND ? decoded.registerSelector1 : decoded.registerSelector2);
+		byteSelector = (op == Operand::FIRST_OPERAND ? decoded.operand1ByteSelector : decoded.operand2ByteSelector);
+		break;
+	case AddressingType::REGISTER_INDIRECT_NO_OFFSET:
+		registerSelector = (op == Operand::FIRST_OPERAND ? decoded.registerSelector1 : decoded.registerSelector2);
+		break;
+	case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
+	case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
+		registerSelector = (op == Operand::FIRST_OPERAND ? decoded.registerSelector1 : decoded.registerSelector2);
+		operand = (op == Operand::FIRST_OPERAND ? decoded.operand1 : decoded.operand2);
+		break;
+	}
+
+	if (op == Operand::FIRST_OPERAND)
+		operand1AddressingType = addressingType;
+	else
+		operand2AddressingType = addressingType;
+}
+
 uint8_t& CPU::GetReference8(Operand op)
 {
 	AddressingType& addressingType = (op == Operand::FIRST_OPERAND ? operand1AddressingType : operand2AddressingType);
@@ -82,7 +122,7 @@ uint8_t& CPU::GetReference8(Operand op)
 	{
 	case AddressingType::IMMEDIATELY:
 	{
-		if (op == FIRST_OPERAND && cpuInstructionsMap.at(instructionMnemonic).numberOfOperands == 2)
+		if (op == FIRST_OPERAND && isaTable[instructionMnemonic].numberOfOperands == 2)
 			SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
 		//throw EmulatorException("Immediately addressed operand cannot be destination.");
 
@@ -94,13 +134,13 @@ uint8_t& CPU::GetReference8(Operand op)
 		else
 			return (uint8_t&)*((uint8_t*)&registerFile[registerSelector] + 1);
 	case AddressingType::REGISTER_INDIRECT_NO_OFFSET:
-		return (uint8_t&)memory_read(registerFile[registerSelector]);
+		return (uint8_t&)GetMemoryOperand(op, registerFile[registerSelector]);
 	case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
-		return (uint8_t&)memory_read(registerFile[registerSelector] + (int8_t)(operand & 0xFF));
+		return (uint8_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int8_t)(operand & 0xFF));
 	case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
-		return (uint8_t&)memory_read(registerFile[registerSelector] + (int16_t)operand);
+		return (uint8_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int16_t)operand);
 	case AddressingType::MEMORY_DIRECT:
-		return *((uint8_t*)(&memory_read(operand)));
+		return *((uint8_t*)(&GetMemoryOperand(op, operand)));
 	default:
 		SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
 		break;
@@ -133,7 +173,7 @@ uint16_t& CPU::GetReference16(Operand op)
 	{
 	case AddressingType::IMMEDIATELY:
 	{
-		if (op == FIRST_OPERAND && cpuInstructionsMap.at(instructionMnemonic).numberOfOperands == 2)
+		if (op == FIRST_OPERAND && isaTable[instructionMnemonic].numberOfOperands == 2)
 			SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
 			//throw EmulatorException("Immediately addressed operand cannot be destination.");
 
@@ -142,13 +182,13 @@ uint16_t& CPU::GetReference16(Operand op)
 	case AddressingType::REGISTER_DIRECT:
 		return registerFile[registerSelector];
 	case AddressingType::REGISTER_INDIRECT_NO_OFFSET:
-		return (uint16_t&)memory_read(registerFile[registerSelector]);
+		return (uint16_t&)GetMemoryOperand(op, registerFile[registerSelector]);
 	case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
-		return (uint16_t&)memory_read(registerFile[registerSelector] + (int8_t)(operand & 0xFF));
+		return (uint16_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int8_t)(operand & 0xFF));
 	case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
-		return (uint16_t&)memory_read(registerFile[registerSelector] + (int16_t)operand);
+		return (uint16_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int16_t)operand);
 	case AddressingType::MEMORY_DIRECT:
-		return *((uint16_t*)(&memory_read(operand)));
+		return *((uint16_t*)(&GetMemoryOperand(op, operand)));
 	default:
 		SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
 		break;
@@ -157,25 +197,251 @@ uint16_t& CPU::GetReference16(Operand op)
 	throw EmulatorException("Unknown addressing type.", ErrorCodes::EMULATOR_UNKNOWN_ADDRESSING);
 }
 
+template <int size>
+inline bool CPU::IsWordOperation()
+{
+	if (size == DYNAMIC_OPERAND)
+		return operandSize == OperandSize::WORD;
+	else
+		return size == OperandSize::WORD;
+}
+
+template <Operand op, int mode>
+inline uint16_t& CPU::Reference16()
+{
+	uint16_t& operand = (op == Operand::FIRST_OPERAND ? operand1 : operand2);
+	uint8_t& registerSelector = (op == Operand::FIRST_OPERAND ? registerSelector1 : registerSelector2);
+
+	// mode is a template argument, so compiler keeps only one of the cases
+	switch (mode)
+	{
+	case DYNAMIC_OPERAND:
+		return GetReference16(op);
+	case AddressingType::IMMEDIATELY:
+	{
+		if (op == FIRST_OPERAND && isaTable[instructionMnemonic].numberOfOperands == 2)
+			SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
+
+		return operand;
+	}
+	case AddressingType::REGISTER_DIRECT:
+		return registerFile[registerSelector];
+	case AddressingType::REGISTER_INDIRECT_NO_OFFSET:
+		return (uint16_t&)GetMemoryOperand(op, registerFile[registerSelector]);
+	case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
+		return (uint16_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int8_t)(operand & 0xFF));
+	case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
+		return (uint16_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int16_t)operand);
+	case AddressingType::MEMORY_DIRECT:
+		return *((uint16_t*)(&GetMemoryOperand(op, operand)));
+	}
+
+	throw EmulatorException("Unknown addressing type.", ErrorCodes::EMULATOR_UNKNOWN_ADDRESSING);
+}
+
+template <Operand op, int mode>
+inline uint8_t& CPU::Reference8()
+{
+	uint16_t& operand = (op == Operand::FIRST_OPERAND ? operand1 : operand2);
+	ByteSelector& byteSelector = (op == Operand::FIRST_OPERAND ? operand1ByteSelector : operand2ByteSelector);
+	uint8_t& registerSelector = (op == Operand::FIRST_OPERAND ? registerSelector1 : registerSelector2);
+
+	switch (mode)
+	{
+	case DYNAMIC_OPERAND:
+		return GetReference8(op);
+	case AddressingType::IMMEDIATELY:
+	{
+		if (op == FIRST_OPERAND && isaTable[instructionMnemonic].numberOfOperands == 2)
+			SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
+
+		return (uint8_t&)operand;
+	}
+	case AddressingType::REGISTER_DIRECT:
+		return *((uint8_t*)&registerFile[registerSelector] + (byteSelector != ByteSelector::LOWER));
+	case AddressingType::REGISTER_INDIRECT_NO_OFFSET:
+		return (uint8_t&)GetMemoryOperand(op, registerFile[registerSelector]);
+	case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
+		return (uint8_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int8_t)(operand & 0xFF));
+	case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
+		return (uint8_t&)GetMemoryOperand(op, registerFile[registerSelector] + (int16_t)operand);
+	case AddressingType::MEMORY_DIRECT:
+		return *((uint8_t*)(&GetMemoryOperand(op, operand)));
+	}
+
+	throw EmulatorException("Unknown addressing type.", ErrorCodes::EMULATOR_UNKNOWN_ADDRESSING);
+}
+
+template <int mode>
+inline uint16_t& CPU::JumpTarget()
+{
+	// same as GetReference16 does for jump instructions
+	bool pcRelative = (mode == DYNAMIC_OPERAND ? operand1AddressingType == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET : mode == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET);
+	if (pcRelative && registerSelector1 == PC_REGISTER)
+		operand1 += (uint16_t)registerFile[PC_REGISTER];
+
+	return operand1;
+}
+
+inline void CPU::LoadDecodedInstruction(const DecodedInstruction& decoded)
+{
+	instructionMnemonic = static_cast<InstructionMnemonic>(decoded.instructionCode);
+	operandSize = decoded.operandSize;
+
+	switch (isaTable[instructionMnemonic].numberOfOperands)
+	{
+	case 2:
+		LoadDecodedOperand(decoded, Operand::FIRST_OPERAND);
+		LoadDecodedOperand(decoded, Operand::SECOND_OPERAND);
+		break;
+	case 1:
+		LoadDecodedOperand(decoded, Operand::FIRST_OPERAND);
+		break;
+	}
+
+	pc += decoded.length;
+	pcAfterDecode = pc;
+}
+
 void CPU::InstructionFetchAndDecode()
 {
-	uint8_t IP;
-	int writeTo = 0;
+	DecodedInstructionCache& cache = executable->GetDecodedCache();
+
+	// training counts pairs in which control fell through from the previous instruction
+	if (fusionTable && fusionTable->IsTraining() && pc == pcAfterDecode)
+	{
+		const DecodedInstruction* next = cache.Lookup(pc);
+		if (next)
+			fusionTable->Record(instructionMnemonic, next->instructionCode);
+	}
+
 	pcBeforeInstruction = pc;
+	operand1Address = -1;
+	operand2Address = -1;
+
+	const DecodedInstruction* decoded = cache.Lookup(pc);
+	// pending invalid instruction interrupt changes how operands are fetched
+	if (decoded && !interrupts.IsPending(InterruptType::INT_INVALID_INSTRUCTION))
+	{
+		LoadDecodedInstruction(*decoded);
+		instructionHandler = specializedHandlers[decoded->handlerIndex];
+
+		// interrupt check is skipped between the halves, so superinstruction is taken only
+		// if no deadline (timer, input, budget, checkpoint) falls on the first half and no
+		// interrupt is waiting; otherwise the pair runs one instruction per dispatch
+		if (decoded->superinstruction && instructionCount + 1 < deviceDeadline && !interrupts.AnyPending())
+		{
+			superinstructionSecond = cache.Lookup(pc);
+			if (superinstructionSecond)
+				instructionHandler = superinstructions[decoded->superinstruction].fused;
+		}
+		return;
+	}
+
+	decodeCacheable = true;
+	InstructionDecode();
+	instructionHandler = specializedHandlers[SpecializedHandlerIndex(instructionMnemonic, operandSize, operand1AddressingType, operand2AddressingType)];
+	pcAfterDecode = pc;
+
+	// instructions reaching into memory mapped registers are never cached since devices change them
+	if (decodeCacheable && pc > pcBeforeInstruction && pc <= MEMORY_MAPPED_REGISTERS_START)
+		CacheDecodedInstruction();
+}
+
+void CPU::CacheDecodedInstruction()
+{
+	DecodedInstruction decoded;
+
+	decoded.length = (uint8_t)(pc - pcBeforeInstruction);
+	decoded.instructionCode = (uint8_t)instructionMnemonic;
+	decoded.operandSize = operandSize;
+	decoded.handlerIndex = SpecializedHandlerIndex(instructionMnemonic, operandSize, operand1AddressingType, operand2AddressingType);
+
+	decoded.operand1AddressingType = operand1AddressingType;
+	decoded.operand1ByteSelector = operand1ByteSelector;
+	decoded.operand1 = operand1;
+	decoded.registerSelector1 = registerSelector1;
+
+	decoded.operand2AddressingType = operand2AddressingType;
+	decoded.operand2ByteSelector = operand2ByteSelector;
+	decoded.operand2 = operand2;
+	decoded.registerSelector2 = registerSelector2;
+
+	DecodedInstructionCache& cache = executable->GetDecodedCache();
+	cache.Insert(pcBeforeInstruction, decoded);
+
+	// superinstructions are formed here, from whichever half of the pair is decoded last
+	if (fusionTable && !fusionTable->IsTraining())
+	{
+		const DecodedInstruction* next = cache.Lookup(pc);
+		if (next)
+			cache.SetSuperinstruction(pcBeforeInstruction, SuperinstructionIndex(decoded, *next));
+
+		for (uint16_t length = 1; length <= MAX_INSTRUCTION_LENGTH; length++)
+		{
+			const DecodedInstruction* previous = cache.Lookup(pcBeforeInstruction - length);
+			if (previous && previous->length == length)
+				cache.SetSuperinstruction(pcBeforeInstruction - length, SuperinstructionIndex(*previous, decoded));
+		}
+	}
+}
+
+uint8_t CPU::SuperinstructionIndex(const DecodedInstruction& first, const DecodedInstruction& second)
+{
+	if (!fusionTable->IsFused(first.instructionCode, second.instructionCode))
+		return 0;
+
+	// second half has to follow the first one in memory, so first half must not write pc
+	// (mov r7, pop r7, ...) nor take it from the stack
+	if ((first.operand1AddressingType == AddressingType::REGISTER_DIRECT && first.registerSelector1 == PC_REGISTER) ||
+		first.instructionCode == InstructionMnemonic::RET || first.instructionCode == InstructionMnemonic::IRET)
+		return 0;
+
+	// handlers are compared rather than indices, one operand handlers ignore the second addressing type
+	InstructionHandler firstHandler = specializedHandlers[first.handlerIndex];
+	InstructionHandler secondHandler = specializedHandlers[second.handlerIndex];
+	for (uint8_t i = 1; i < SUPERINSTRUCTIONS_SIZE; i++)
+		if (superinstructions[i].first == firstHandler && superinstructions[i].second == secondHandler)
+			return i;
+
+	return 0;
+}
+
+void CPU::FormSuperinstructions()
+{
+	if (!fusionTable || fusionTable->IsTraining())
+		return;
+
+	DecodedInstructionCache& cache = executable->GetDecodedCache();
+	for (uint32_t address = 0; address < MEMORY_MAPPED_REGISTERS_START; address++)
+	{
+		const DecodedInstruction* decoded = cache.Lookup(address);
+		const DecodedInstruction* next = (decoded ? cache.Lookup(address + decoded->length) : 0);
+		if (next)
+			cache.SetSuperinstruction(address, SuperinstructionIndex(*decoded, *next));
+	}
+}
+
+void CPU::InstructionDecode()
+{
+	uint8_t IP;
 
 	IP = memory_read(pc++);
 	uint8_t instructionCode = ((IP >> 3) & 0x1F);
 	uint8_t size = ((IP & 0x04) >> 2);
-	if (instructionCode >= 1 && instructionCode <= 25)
+	if (isaTable[instructionCode].mnemonic)
 	{
 		instructionMnemonic = static_cast<InstructionMnemonic>(instructionCode);
 		operandSize = static_cast<OperandSize>(size);
 	}
 	else
+	{
+		decodeCacheable = false;
 		SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
+	}
 		//throw EmulatorException("Unknown operation code detected.", ErrorCodes::EMULATOR_UNKNOWN_INSTRUCTION);
 
-	InstructionDetails& details = cpuInstructionsMap.at(instructionMnemonic);
+	const ISAInstruction& details = isaTable[instructionMnemonic];
 
 	switch (details.numberOfOperands)
 	{
@@ -199,523 +465,794 @@ void CPU::InstructionFetchAndDecode()
 		break;
 	}
 	default:
+		decodeCacheable = false;
 		SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
 		break;
 		//throw EmulatorException("Unknown instruction addressing field.", ErrorCodes::EMULATOR_UNKNOWN_INSTRUCTION);
 	}
 }
 
-void CPU::InstructionExecute()
+bool CPU::InstructionPrologue()
 {
 	if (!executable->CheckIfExecutable(pcBeforeInstruction, pc - pcBeforeInstruction))
 		EmulatorException("Loaded code is not in executable section. Emulation aborted.", ErrorCodes::EMULATOR_NON_EXECUTABLE_SECTION);
 	
-	if (interruptRequests.size() != 0 && interruptRequests.top() == InterruptType::INT_INVALID_INSTRUCTION)
+	if (interrupts.IsPending(InterruptType::INT_INVALID_INSTRUCTION))
+		return false;
+
+	return true;
+}
+
+void CPU::InstructionEpilogue()
+{
+	instructionCount++;
+
+	if (operand1Address != -1 || operand2Address != -1)
+		InvalidateWrittenOperands();
+
+	// jump to itself, or back over constant moves into registers, changes nothing once
+	// the loop has run through, only an interrupt can get processor out of it
+	if (pc <= pcBeforeInstruction && instructionMnemonic >= InstructionMnemonic::JMP && instructionMnemonic <= InstructionMnemonic::JGT &&
+		pcBeforeInstruction - pc <= IDLE_LOOP_MAX_LENGTH)
+		CheckIdleLoop();
+}
+
+void CPU::CheckIdleLoop()
+{
+	if (pc != pcBeforeInstruction)
+	{
+		if (!JITCompiler::IsIdleLoopBody(executable->memory, pc, pcBeforeInstruction))
+			return;
+
+		// loop may have been entered at its branch, its moves have to run once before sleeping
+		if (idleLoopBranch != pcBeforeInstruction)
+		{
+			idleLoopBranch = pcBeforeInstruction;
+			return;
+		}
+	}
+
+	WaitForInterrupt();
+}
+
+void CPU::InstructionExecute()
+{
+	if (!InstructionPrologue())
 		return;
 
 	// debug condition: initializationFinished && instructionMnemonic != InstructionMnemonic::IRET
 	switch (instructionMnemonic)
 	{
 	case InstructionMnemonic::HALT:
-	{
-		halted = true;
+		ExecuteHalt();
 		break;
-	}
 	case InstructionMnemonic::XCHG:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			uint16_t temp = dst;
-			dst = src;
-			src = temp;
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			uint8_t temp = dst;
-			dst = src;
-			src = temp;
-		}
+		ExecuteXchg();
 		break;
-	}
 	case InstructionMnemonic::INT:
-	{
-		uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-
-		memory_push_16(psw);
-		pc = memory_read((dst % 8) << 1);
-		psw = psw & (~(int16_t)FLAG_I);
-
+		ExecuteInt();
 		break;
-	}
 	case InstructionMnemonic::MOV:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			dst = src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			dst = src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteMov();
 		break;
-	}
 	case InstructionMnemonic::ADD:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			SetFlagO(src, dst, dst + src, InstructionMnemonic::ADD);
-			SetFlagC(src, dst, dst + src, InstructionMnemonic::ADD);
-			dst += src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			SetFlagO(src, dst, dst + src, InstructionMnemonic::ADD);
-			SetFlagC(src, dst, dst + src, InstructionMnemonic::ADD);
-			dst += src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteAdd();
 		break;
-	}
 	case InstructionMnemonic::SUB:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			SetFlagO(src, dst, dst - src, InstructionMnemonic::SUB);
-			SetFlagC(src, dst, dst - src, InstructionMnemonic::SUB);
-			dst -= src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			SetFlagO(src, dst, dst - src, InstructionMnemonic::SUB);
-			SetFlagC(src, dst, dst - src, InstructionMnemonic::SUB);
-			dst -= src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteSub();
 		break;
-	}
 	case InstructionMnemonic::MUL:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			dst *= src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			dst *= src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteMul();
 		break;
-	}
 	case InstructionMnemonic::DIV:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			dst /= src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			dst /= src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteDiv();
 		break;
-	}
 	case InstructionMnemonic::CMP:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			uint16_t temp = dst - src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)temp);
-			SetFlagO(src, dst, temp, InstructionMnemonic::CMP);
-			SetFlagC(src, dst, temp, InstructionMnemonic::CMP);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			uint8_t temp = dst - src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)temp);
-			SetFlagO(src, dst, temp, InstructionMnemonic::CMP);
-			SetFlagC(src, dst, temp, InstructionMnemonic::CMP);
-		}
+		ExecuteCmp();
 		break;
-	}
 	case InstructionMnemonic::NOT:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			dst = ~dst;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			dst = ~dst;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteNot();
 		break;
-	}
 	case InstructionMnemonic::AND:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			dst = dst & src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			dst = dst & src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteAnd();
 		break;
-	}
 	case InstructionMnemonic::OR:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			dst = dst | src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			dst = dst | src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteOr();
 		break;
-	}
 	case InstructionMnemonic::XOR:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			dst = dst ^ src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			dst = dst ^ src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteXor();
 		break;
-	}
 	case InstructionMnemonic::TEST:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			uint16_t temp = dst & src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)temp);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			uint8_t temp = dst & src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)temp);
-		}
+		ExecuteTest();
 		break;
-	}
 	case InstructionMnemonic::SHL:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			SetFlagC(src, dst, dst << src, InstructionMnemonic::CMP);
-			dst = dst << src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			SetFlagC(src, dst, dst << src, InstructionMnemonic::CMP);
-			dst = dst << src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteShl();
 		break;
-	}
 	case InstructionMnemonic::SHR:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			uint16_t& src = GetReference16(Operand::SECOND_OPERAND);
-			SetFlagC(src, dst, dst >> src, InstructionMnemonic::CMP);
-			dst = dst >> src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int16_t)dst);
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			uint8_t& src = GetReference8(Operand::SECOND_OPERAND);
-			SetFlagC(src, dst, dst >> src, InstructionMnemonic::CMP);
-			dst = dst >> src;
-			SetFlagsZN(FLAG_Z | FLAG_N, (int8_t)dst);
-		}
+		ExecuteShr();
 		break;
-	}
 	case InstructionMnemonic::PUSH:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& src = GetReference16(Operand::FIRST_OPERAND);
-			memory_push_16(src);
-		}
-		else
-		{
-			uint8_t& src = GetReference8(Operand::FIRST_OPERAND);
-			memory_push(src);
-		}
+		ExecutePush();
 		break;
-	}
 	case InstructionMnemonic::POP:
-	{
-		if (operandSize == OperandSize::WORD)
-		{
-			uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-			dst = memory_pop_16();
-		}
-		else
-		{
-			uint8_t& dst = GetReference8(Operand::FIRST_OPERAND);
-			dst = memory_pop();
-		}
+		ExecutePop();
 		break;
-	}
 	case InstructionMnemonic::JMP:
-	{
-		uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-		pc = (int16_t)dst;
+		ExecuteJmp();
 		break;
-	}
 	case InstructionMnemonic::JEQ:
-	{
-		uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-		if (GetZ())
-			pc = (int16_t)dst;
+		ExecuteJeq();
 		break;
-	}
 	case InstructionMnemonic::JNE:
-	{
-		uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-		if (!GetZ())
-			pc = (int16_t)dst;
+		ExecuteJne();
 		break;
-	}
 	case InstructionMnemonic::JGT:
-	{
-		uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-		if ((GetN() ^ GetO()) == 0)	// 1. ort2.kol2 -> N xor V; 2. x86 ->ZERO=0 && (OVERFLOW=SIGNED)
-			pc = (int16_t)dst;
+		ExecuteJgt();
 		break;
-	}
 	case InstructionMnemonic::CALL:
-	{
-		uint16_t& dst = GetReference16(Operand::FIRST_OPERAND);
-		memory_push_16(pc);
-		pc = dst;
+		ExecuteCall();
 		break;
-	}
 	case InstructionMnemonic::RET:
-	{
-		pc = memory_pop_16();
+		ExecuteRet();
 		break;
-	}
 	case InstructionMnemonic::IRET:
-	{
-		psw = memory_pop_16();
-		pc = memory_pop_16();
+		ExecuteIret();
+		break;
+	case InstructionMnemonic::WAIT:
+		ExecuteWait();
 		break;
-	}
 	default:
 		SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
 		break;
 		//throw EmulatorException("Unknown instruction.", ErrorCodes::EMULATOR_UNKNOWN_INSTRUCTION);
 	}
+
+	InstructionEpilogue();
 }
 
-void CPU::InstructionHandleInterrupt()
+void CPU::InstructionExecuteSpecialized()
+{
+	if (!InstructionPrologue())
+		return;
+
+	(this->*instructionHandler)();
+
+	InstructionEpilogue();
+}
+
+void CPU::ExecuteInvalid()
+{
+	SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
+}
+
+void CPU::ExecuteHalt()
+{
+	halted = true;
+}
+
+void CPU::ExecuteWait()
+{
+	WaitForInterrupt();
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteXchg()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		uint16_t temp = dst;
+		dst = src;
+		src = temp;
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		uint8_t temp = dst;
+		dst = src;
+		src = temp;
+	}
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteInt()
+{
+	uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+
+	EvaluateFlags();
+	memory_push_16(psw);
+	pc = memory_read((dst % 8) << 1);
+	psw = psw & (~(int16_t)FLAG_I);
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteMov()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		dst = src;
+		DeferFlagsZN((int16_t)dst);
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		dst = src;
+		DeferFlagsZN((int8_t)dst);
+	}
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteAdd()
 {
-	char c;
-	memoryMutex.lock();
-	if ((c = (char)memory_read(TERMINAL_DATA_OUT)) != 0)
+	if (IsWordOperation<size>())
 	{
-		memory_write(TERMINAL_DATA_OUT, 0);
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagO(src, dst, dst + src, InstructionMnemonic::ADD);
+		DeferFlagC(src, dst, dst + src, InstructionMnemonic::ADD);
+		dst += src;
+		DeferFlagsZN((int16_t)dst);
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagO(src, dst, dst + src, InstructionMnemonic::ADD);
+		DeferFlagC(src, dst, dst + src, InstructionMnemonic::ADD);
+		dst += src;
+		DeferFlagsZN((int8_t)dst);
+	}
+}
 
-		cout << c;
+template <int size, int mode1, int mode2>
+void CPU::ExecuteSub()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagO(src, dst, dst - src, InstructionMnemonic::SUB);
+		DeferFlagC(src, dst, dst - src, InstructionMnemonic::SUB);
+		dst -= src;
+		DeferFlagsZN((int16_t)dst);
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagO(src, dst, dst - src, InstructionMnemonic::SUB);
+		DeferFlagC(src, dst, dst - src, InstructionMnemonic::SUB);
+		dst -= src;
+		DeferFlagsZN((int8_t)dst);
 	}
-	memoryMutex.unlock();
+}
 
-	emulatorStatusMutex.lock();
-	if (interruptRequests.size() == 0)
+template <int size, int mode1, int mode2>
+void CPU::ExecuteMul()
+{
+	if (IsWordOperation<size>())
 	{
-		emulatorStatusMutex.unlock();
-		return;
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		dst *= src;
+		DeferFlagsZN((int16_t)dst);
 	}
-	InterruptType itype = interruptRequests.top();
-	// INT_INVALID_INSTRUCTION is non-maskable interrupt
-	if (((itype != InterruptType::INT_INVALID_INSTRUCTION) && (!(psw & FLAG_I))) ||
-		((itype == InterruptType::KEYBOARD) && (!(psw & FLAG_Tl))) ||
-		((itype == InterruptType::TIMER) && (!(psw & FLAG_Tr))))
+	else
 	{
-		emulatorStatusMutex.unlock();
-		return;
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		dst *= src;
+		DeferFlagsZN((int8_t)dst);
 	}
-	interruptRequests.pop();
-	emulatorStatusMutex.unlock();
-	
-	memory_push_16(pc);
-	memory_push_16(psw);
+}
 
-	psw = psw & (~(int16_t)FLAG_I);
-	pc = memory_read_16(IVT_START + 2 * (uint16_t)itype);
+template <int size, int mode1, int mode2>
+void CPU::ExecuteDiv()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		dst /= src;
+		DeferFlagsZN((int16_t)dst);
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		dst /= src;
+		DeferFlagsZN((int8_t)dst);
+	}
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteCmp()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		uint16_t temp = dst - src;
+		DeferFlagsZN((int16_t)temp);
+		DeferFlagO(src, dst, temp, InstructionMnemonic::CMP);
+		DeferFlagC(src, dst, temp, InstructionMnemonic::CMP);
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		uint8_t temp = dst - src;
+		DeferFlagsZN((int8_t)temp);
+		DeferFlagO(src, dst, temp, InstructionMnemonic::CMP);
+		DeferFlagC(src, dst, temp, InstructionMnemonic::CMP);
+	}
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteNot()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		dst = ~dst;
+		DeferFlagsZN((int16_t)dst);
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		dst = ~dst;
+		DeferFlagsZN((int8_t)dst);
+	}
 }
 
-inline void CPU::SetFlagsZN(uint8_t flags, int16_t result)
+template <int size, int mode1, int mode2>
+void CPU::ExecuteAnd()
 {
-	if ((flags & FLAG_Z) && (result == 0))
-		psw = psw | FLAG_Z;
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		dst = dst & src;
+		DeferFlagsZN((int16_t)dst);
+	}
 	else
-		psw = psw & (~(int16_t)FLAG_Z);
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		dst = dst & src;
+		DeferFlagsZN((int8_t)dst);
+	}
+}
 
-	if ((flags & FLAG_N) && (result < 0))
-		psw = psw | FLAG_N;
+template <int size, int mode1, int mode2>
+void CPU::ExecuteOr()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		dst = dst | src;
+		DeferFlagsZN((int16_t)dst);
+	}
 	else
-		psw = psw & (~(int16_t)FLAG_N);
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		dst = dst | src;
+		DeferFlagsZN((int8_t)dst);
+	}
 }
 
-inline void CPU::SetFlagO(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation)
+template <int size, int mode1, int mode2>
+void CPU::ExecuteXor()
 {
-	switch (operation)
+	if (IsWordOperation<size>())
 	{
-	case InstructionMnemonic::ADD:
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		dst = dst ^ src;
+		DeferFlagsZN((int16_t)dst);
+	}
+	else
 	{
-		if ((src >= 0 && dst >= 0 && r < 0) || (src < 0 && dst < 0 && r >= 0))
-			psw = psw | FLAG_O;
-		else
-			psw = psw & (~(int16_t)FLAG_O);
-		break;
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		dst = dst ^ src;
+		DeferFlagsZN((int8_t)dst);
 	}
-	case InstructionMnemonic::SUB:
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteTest()
+{
+	if (IsWordOperation<size>())
 	{
-		// PSWC i PSWV - by Hadzic ORT2
-		if ((src >= 0 && dst < 0 && r < 0) || (src < 0 && dst >= 0 && r >= 0))
-			psw = psw | FLAG_O;
-		else
-			psw = psw & (~(int16_t)FLAG_O);
-		break;
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		uint16_t temp = dst & src;
+		DeferFlagsZN((int16_t)temp);
 	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		uint8_t temp = dst & src;
+		DeferFlagsZN((int8_t)temp);
 	}
 }
 
-inline void CPU::SetFlagC(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation)
+template <int size, int mode1, int mode2>
+void CPU::ExecuteShl()
 {
-	switch (operation)
+	if (IsWordOperation<size>())
 	{
-	case InstructionMnemonic::ADD:
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagC(src, dst, dst << src, InstructionMnemonic::CMP);
+		dst = dst << src;
+		DeferFlagsZN((int16_t)dst);
+	}
+	else
 	{
-		if ((src >= 0 && dst >= 0) || (src >= 0 && dst < 0 && r < 0) || (src < 0 && dst >= 0 && r < 0))
-			psw = psw | FLAG_C;
-		else
-			psw = psw & (~(int16_t)FLAG_C);
-		break;
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagC(src, dst, dst << src, InstructionMnemonic::CMP);
+		dst = dst << src;
+		DeferFlagsZN((int8_t)dst);
 	}
-	case InstructionMnemonic::SUB:
-	case InstructionMnemonic::CMP:
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteShr()
+{
+	if (IsWordOperation<size>())
 	{
-		if ((src >= 0 && dst < 0 && r < 0) || (src >= 0 && dst >= 0 && r >= 0) || (src < 0 && dst >= 0 && r >= 0))
-			psw = psw | FLAG_C;
-		else
-			psw = psw & (~(int16_t)FLAG_C);
-		break;
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		uint16_t& src = Reference16<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagC(src, dst, dst >> src, InstructionMnemonic::CMP);
+		dst = dst >> src;
+		DeferFlagsZN((int16_t)dst);
 	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		uint8_t& src = Reference8<Operand::SECOND_OPERAND, mode2>();
+		DeferFlagC(src, dst, dst >> src, InstructionMnemonic::CMP);
+		dst = dst >> src;
+		DeferFlagsZN((int8_t)dst);
+	}
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecutePush()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& src = Reference16<Operand::FIRST_OPERAND, mode1>();
+		memory_push_16(src);
+	}
+	else
+	{
+		uint8_t& src = Reference8<Operand::FIRST_OPERAND, mode1>();
+		memory_push(src);
+	}
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecutePop()
+{
+	if (IsWordOperation<size>())
+	{
+		uint16_t& dst = Reference16<Operand::FIRST_OPERAND, mode1>();
+		dst = memory_pop_16();
+	}
+	else
+	{
+		uint8_t& dst = Reference8<Operand::FIRST_OPERAND, mode1>();
+		dst = memory_pop();
+	}
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteJmp()
+{
+	uint16_t& dst = JumpTarget<mode1>();
+	pc = (int16_t)dst;
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteJeq()
+{
+	uint16_t& dst = JumpTarget<mode1>();
+	if (GetZ())
+		pc = (int16_t)dst;
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteJne()
+{
+	uint16_t& dst = JumpTarget<mode1>();
+	if (!GetZ())
+		pc = (int16_t)dst;
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteJgt()
+{
+	uint16_t& dst = JumpTarget<mode1>();
+	if ((GetN() ^ GetO()) == 0)	// 1. ort2.kol2 -> N xor V; 2. x86 ->ZERO=0 && (OVERFLOW=SIGNED)
+		pc = (int16_t)dst;
+}
+
+template <int size, int mode1, int mode2>
+void CPU::ExecuteCall()
+{
+	uint16_t& dst = JumpTarget<mode1>();
+	memory_push_16(pc);
+	pc = dst;
+}
+
+void CPU::ExecuteRet()
+{
+	pc = memory_pop_16();
+}
+
+void CPU::ExecuteIret()
+{
+	DiscardDeferredFlags();
+	psw = memory_pop_16();
+	pc = memory_pop_16();
+
+	// keyboard handler is done with TERMINAL_DATA_IN, next typed character can take its place
+	if (sp == keyboardReturnSP)
+	{
+		keyboardReturnSP = -1;
+		terminal.KeyboardHandled(*this);
+	}
+}
+
+void CPU::InvalidateWrittenOperands()
+{
+	// stores through operand references bypass Executable::MemoryWrite,
+	// devices learn about stores into their registers here as well
+	uint16_t length = (operandSize == OperandSize::WORD ? 2 : 1);
+
+	switch (instructionMnemonic)
+	{
+	case InstructionMnemonic::XCHG:
+		for (uint16_t i = 0; operand2Address != -1 && i < length; i++)
+			OperandByteWritten(operand2Address + i);
+		// first operand is written too
+		[[fallthrough]];
+	case InstructionMnemonic::MOV:
+	case InstructionMnemonic::ADD:
+	case InstructionMnemonic::SUB:
+	case InstructionMnemonic::MUL:
+	case InstructionMnemonic::DIV:
+	case InstructionMnemonic::NOT:
+	case InstructionMnemonic::AND:
+	case InstructionMnemonic::OR:
+	case InstructionMnemonic::XOR:
 	case InstructionMnemonic::SHL:
 	case InstructionMnemonic::SHR:
+	case InstructionMnemonic::POP:
+		for (uint16_t i = 0; operand1Address != -1 && i < length; i++)
+			OperandByteWritten(operand1Address + i);
+		break;
+	}
+}
+
+void CPU::InstructionHandleInterrupt()
+{
+	if (instructionCount >= deviceDeadline)
+		ServiceDeadlines();
+	if (checkpointDue)
+		SaveCheckpoint();
+
+	if (!interrupts.AnyPending())
+		return;
+
+	int itype = interrupts.Acknowledge(psw);
+	if (itype < 0)
+		return;
+	
+	if (itype == InterruptType::KEYBOARD)
+		keyboardReturnSP = sp;
+
+	memory_push_16(pc);
+	EvaluateFlags();
+	memory_push_16(psw);
+
+	psw = psw & (~(int16_t)FLAG_I);
+	pc = memory_read_16(IVT_START + 2 * (uint16_t)itype);
+}
+
+CPU::CPU()
+{
+	devices.Map(&terminal, TERMINAL_DATA_OUT, 2);
+	devices.Map(&timer, TIMER_CFG, 2);
+	devices.Map(&semihost, SEMIHOST_ADDRESS, SEMIHOST_COMMAND - SEMIHOST_ADDRESS + 2);
+	devices.Map(&dma, DMA_SOURCE, DMA_MODE - DMA_SOURCE + 2);
+	devices.Map(&storage, STORAGE_SECTOR, STORAGE_SECTORS - STORAGE_SECTOR + 2);
+}
+
+void CPU::ServiceDeadlines()
+{
+	if (instructionCount >= timerDeadline)
 	{
-		int16_t r = dst;
-		for (int i = 1; i <= src; i++)
-		{
-			if (r < 0)
-				psw = psw | FLAG_C;
-			else
-				psw = psw & (~(int16_t)FLAG_C);
-
-			if (operation == InstructionMnemonic::SHL)
-				r = r << 1;
-			else
-				r = r >> 1;
-		}
+		interrupts.Request(InterruptType::TIMER);
+		timerDeadline += timer.PeriodInstructions();
+	}
 
-		break;
+	if (instructionCount >= inputDeadline)
+		inputDeadline = terminal.DeliverInput(*this) ? instructionCount + terminal.InputRate() : UINT64_MAX;
+
+	if (instructionCount >= budgetDeadline)
+	{
+		halted = true;
+		budgetExhausted = true;
+		budgetDeadline = UINT64_MAX;
 	}
+
+	if (instructionCount >= checkpointDeadline)
+	{
+		checkpointDue = true;
+		checkpointDeadline = instructionCount + checkpointInterval;
 	}
+
+	UpdateDeviceDeadline();
 }
 
-void CPU::StartThreads()
+void CPU::WaitForInterrupt()
 {
-	keyboardThread = new thread(KeyboardHandler, this);
-	timerThread = new thread(TimerHandler, this);
+	// virtual time passes at once while processor waits, up to deadlines that can wake it;
+	// checkpoint deadline cannot, checkpoint due by then is taken once the wait is over
+	while (!interrupts.Deliverable(psw) && !halted)
+	{
+		uint64_t wakeDeadline = min(min(timerDeadline, inputDeadline), budgetDeadline);
+		if (wakeDeadline == UINT64_MAX)
+			break;
+
+		// masked timer is all that is left, further ticks change nothing
+		if (inputDeadline == UINT64_MAX && interrupts.IsPending(InterruptType::TIMER))
+			return;
+
+		instructionCount = max(instructionCount, wakeDeadline);
+		ServiceDeadlines();
+	}
+
+	// without event loop nothing else can request an interrupt
+	if (eventLoop && !interrupts.Deliverable(psw) && !halted)
+		interrupts.WaitForRequest(psw);
 }
 
-CPU::~CPU()
+void CPU::StartEventLoop()
+{
+	// virtual time timer and streamed input are driven by executed instructions instead of event loop;
+	// deadlines restored from a snapshot are kept, so resumed run ticks at the same instructions
+	if (!timer.IsVirtual())
+		timerDeadline = UINT64_MAX;
+	else if (timerDeadline == UINT64_MAX)
+		timerDeadline = instructionCount + timer.PeriodInstructions();
+	if (!terminal.HasInput())
+		inputDeadline = UINT64_MAX;
+	else if (inputDeadline == UINT64_MAX)
+		inputDeadline = instructionCount + terminal.InputRate();
+	if (checkpointWriter)
+		checkpointDeadline = instructionCount + checkpointInterval;
+	StartBudget();
+
+	bool keyboard = keyboardEnabled && !terminal.HasInput();
+	if (!keyboard && timer.IsVirtual())
+		return;
+
+	eventLoop = new EventLoop(*this, keyboard);
+	eventLoop->Start();
+}
+
+void CPU::StartBudget()
+{
+	budgetDeadline = instructionBudget ? instructionCount + instructionBudget : UINT64_MAX;
+	budgetExhausted = false;
+	UpdateDeviceDeadline();
+}
+
+void CPU::SaveCheckpoint()
+{
+	// output produced before checkpoint must not be lost if run is resumed from it
+	terminal.Flush();
+	checkpointWriter->Submit(*this);
+	checkpointDue = false;
+}
+
+void CPU::SaveState(Snapshot& snapshot, bool trackWrites)
+{
+	EvaluateFlags();
+	memcpy(snapshot.registerFile, registerFile, sizeof(registerFile));
+	snapshot.psw = psw;
+	snapshot.halted = halted;
+	snapshot.initializationFinished = initializationFinished;
+	snapshot.pendingInterrupts = interrupts.Pending();
+	snapshot.timerConfiguration = timer.Configuration();
+
+	snapshot.instructionCount = instructionCount;
+	snapshot.timerDeadline = timerDeadline;
+	snapshot.inputDeadline = inputDeadline;
+	snapshot.budgetDeadline = budgetDeadline;
+	snapshot.budgetExhausted = budgetExhausted;
+
+	snapshot.generation = executable->SaveMemory(snapshot.memory, trackWrites);
+}
+
+void CPU::RestoreState(const Snapshot& snapshot)
+{
+	DiscardDeferredFlags();
+	memcpy(registerFile, snapshot.registerFile, sizeof(registerFile));
+	psw = snapshot.psw;
+	halted = snapshot.halted;
+	initializationFinished = snapshot.initializationFinished;
+	interrupts.Restore(snapshot.pendingInterrupts);
+	timer.Configure(snapshot.timerConfiguration);
+
+	instructionCount = snapshot.instructionCount;
+	timerDeadline = snapshot.timerDeadline;
+	inputDeadline = snapshot.inputDeadline;
+	budgetDeadline = snapshot.budgetDeadline;
+	budgetExhausted = snapshot.budgetExhausted;
+	UpdateDeviceDeadline();
+
+	batchCount = 0;
+	pollNow = false;
+	idleLoopBranch = -1;
+	keyboardReturnSP = -1;
+
+	executable->RestoreMemory(snapshot.memory, snapshot.generation);
+}
+
+void CPU::StopEventLoop()
 {
 	// IF needed because of exception throwing could cause crash
-	if (timerThread)
+	if (eventLoop)
 	{
-		timerThread->join();
-		delete timerThread;
+		eventLoop->Stop();
+		delete eventLoop;
+		eventLoop = 0;
 	}
-	if (keyboardThread)
+}
+
+CPU::~CPU()
+{
+	StopEventLoop();
+}
+
+void CPU::EvaluateFlags()
+{
+	if (deferredZN)
 	{
-		cout << "Press ENTER key to end..." << endl;
-		keyboardThread->join();
-		delete keyboardThread;
+		SetFlagsZN(FLAG_Z | FLAG_N, deferredResult);
+		deferredZN = false;
 	}
+
+	EvaluateFlagO();
+	EvaluateFlagC();
+}
+
+uint16_t CPU::ArithmeticFlags(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation)
+{
+	uint16_t savedPSW = psw;
+
+	psw = 0;
+	SetFlagO(src, dst, r, operation);
+	SetFlagC(src, dst, r, operation);
+	uint16_t flags = psw;
+
+	psw = savedPSW;
+	return flags;
 }
 
 void CPU::WriteIO(const uint16_t & address, const uint8_t & data)
@@ -733,7 +1270,183 @@ void CPU::WriteIO(const uint16_t & address, const uint8_t & data)
 
 void CPU::SetInterrupt(const InterruptType & type)
 {
-	emulatorStatusMutex.lock();
-	interruptRequests.push(type);
-	emulatorStatusMutex.unlock();
-}
\ No newline at end of file
+	interrupts.Request(type);
+
+	// only processor raises invalid instruction interrupt, it is handled before anything else runs
+	if (type == InterruptType::INT_INVALID_INSTRUCTION)
+		pollNow = true;
+}
+
+template <InstructionHandler first, InstructionHandler second>
+void CPU::ExecuteSuperinstruction()
+{
+	(this->*first)();
+	// first half transferred control, or wrote over the second one (push into own code) which
+	// has to be decoded again; caller's epilogue completes the first half as an ordinary instruction
+	if (pc != pcAfterDecode || !superinstructionSecond->valid)
+		return;
+	InstructionEpilogue();
+
+	pcBeforeInstruction = pc;
+	operand1Address = -1;
+	operand2Address = -1;
+	LoadDecodedInstruction(*superinstructionSecond);
+
+	// first halves raise no interrupts, so prologue lets the second half run
+	InstructionPrologue();
+	(this->*second)();
+}
+
+// handler selection for specialized handlers table; invalid operation codes
+// end in ExecuteInvalid and invalid addressing types in dynamic handlers
+// which react to them the same way the switch dispatch does
+#define STATIC_MODE(mode) ((mode) <= AddressingType::MEMORY_DIRECT)
+
+#define NO_OPERANDS_HANDLER(mnemonic, method) \
+	template <int size, int mode1, int mode2> \
+	struct CPU::HandlerSelector<InstructionMnemonic::mnemonic, size, mode1, mode2> \
+	{ \
+		static InstructionHandler Get() { return &CPU::method; } \
+	};
+
+#define ONE_OPERAND_HANDLER(mnemonic, method) \
+	template <int size, int mode1, int mode2> \
+	struct CPU::HandlerSelector<InstructionMnemonic::mnemonic, size, mode1, mode2> \
+	{ \
+		static InstructionHandler Get() \
+		{ \
+			return &CPU::method<STATIC_MODE(mode1) ? size : DYNAMIC_OPERAND, \
+				STATIC_MODE(mode1) ? mode1 : DYNAMIC_OPERAND, \
+				DYNAMIC_OPERAND>; \
+		} \
+	};
+
+#define TWO_OPERANDS_HANDLER(mnemonic, method) \
+	template <int size, int mode1, int mode2> \
+	struct CPU::HandlerSelector<InstructionMnemonic::mnemonic, size, mode1, mode2> \
+	{ \
+		static InstructionHandler Get() \
+		{ \
+			return &CPU::method<STATIC_MODE(mode1) && STATIC_MODE(mode2) ? size : DYNAMIC_OPERAND, \
+				STATIC_MODE(mode1) && STATIC_MODE(mode2) ? mode1 : DYNAMIC_OPERAND, \
+				STATIC_MODE(mode1) && STATIC_MODE(mode2) ? mode2 : DYNAMIC_OPERAND>; \
+		} \
+	};
+
+template <int code, int size, int mode1, int mode2>
+struct CPU::HandlerSelector
+{
+	static InstructionHandler Get() { return &CPU::ExecuteInvalid; }
+};
+
+NO_OPERANDS_HANDLER(HALT, ExecuteHalt)
+NO_OPERANDS_HANDLER(RET, ExecuteRet)
+NO_OPERANDS_HANDLER(IRET, ExecuteIret)
+NO_OPERANDS_HANDLER(WAIT, ExecuteWait)
+
+ONE_OPERAND_HANDLER(INT, ExecuteInt)
+ONE_OPERAND_HANDLER(NOT, ExecuteNot)
+ONE_OPERAND_HANDLER(PUSH, ExecutePush)
+ONE_OPERAND_HANDLER(POP, ExecutePop)
+ONE_OPERAND_HANDLER(JMP, ExecuteJmp)
+ONE_OPERAND_HANDLER(JEQ, ExecuteJeq)
+ONE_OPERAND_HANDLER(JNE, ExecuteJne)
+ONE_OPERAND_HANDLER(JGT, ExecuteJgt)
+ONE_OPERAND_HANDLER(CALL, ExecuteCall)
+
+TWO_OPERANDS_HANDLER(XCHG, ExecuteXchg)
+TWO_OPERANDS_HANDLER(MOV, ExecuteMov)
+TWO_OPERANDS_HANDLER(ADD, ExecuteAdd)
+TWO_OPERANDS_HANDLER(SUB, ExecuteSub)
+TWO_OPERANDS_HANDLER(MUL, ExecuteMul)
+TWO_OPERANDS_HANDLER(DIV, ExecuteDiv)
+TWO_OPERANDS_HANDLER(CMP, ExecuteCmp)
+TWO_OPERANDS_HANDLER(AND, ExecuteAnd)
+TWO_OPERANDS_HANDLER(OR, ExecuteOr)
+TWO_OPERANDS_HANDLER(XOR, ExecuteXor)
+TWO_OPERANDS_HANDLER(TEST, ExecuteTest)
+TWO_OPERANDS_HANDLER(SHL, ExecuteShl)
+TWO_OPERANDS_HANDLER(SHR, ExecuteShr)
+
+template <size_t... indices>
+array<InstructionHandler, SPECIALIZED_HANDLERS_SIZE> CPU::MakeSpecializedHandlers(index_sequence<indices...>)
+{
+	return { {
+		HandlerSelector<(int)((indices >> 7) & 0x1F), (int)((indices >> 6) & 0x01), (int)((indices >> 3) & 0x07), (int)(indices & 0x07)>::Get()...
+	} };
+}
+
+const array<InstructionHandler, SPECIALIZED_HANDLERS_SIZE> CPU::specializedHandlers = CPU::MakeSpecializedHandlers(make_index_sequence<SPECIALIZED_HANDLERS_SIZE>());
+
+// superinstructions, all on word operands of registers or immediates; jump halves
+// take immediate, memory direct and pc relative targets
+#define REGISTER_HANDLER(method, source) &CPU::method<OperandSize::WORD, AddressingType::REGISTER_DIRECT, AddressingType::source>
+#define JUMP_HANDLER(method, target) &CPU::method<OperandSize::WORD, AddressingType::target, DYNAMIC_OPERAND>
+#define ONE_OPERAND_REGISTER_HANDLER(method) &CPU::method<OperandSize::WORD, AddressingType::REGISTER_DIRECT, DYNAMIC_OPERAND>
+
+#define SUPERINSTRUCTION(first, second) { first, second, &CPU::ExecuteSuperinstruction<first, second> }
+
+#define BRANCH_SUPERINSTRUCTIONS(method, source) \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJeq, IMMEDIATELY)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJeq, MEMORY_DIRECT)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJeq, REGISTER_INDIRECT_16_BIT_OFFSET)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJne, IMMEDIATELY)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJne, MEMORY_DIRECT)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJne, REGISTER_INDIRECT_16_BIT_OFFSET)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJgt, IMMEDIATELY)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJgt, MEMORY_DIRECT)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(method, source), JUMP_HANDLER(ExecuteJgt, REGISTER_INDIRECT_16_BIT_OFFSET))
+
+#define MOVE_SUPERINSTRUCTIONS(moveSource, source) \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteAdd, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteSub, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteMul, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteCmp, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteAnd, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteOr, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteXor, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteTest, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteShl, source)), \
+	SUPERINSTRUCTION(REGISTER_HANDLER(ExecuteMov, moveSource), REGISTER_HANDLER(ExecuteShr, source))
+
+const array<Superinstruction, SUPERINSTRUCTIONS_SIZE> CPU::superinstructions = { {
+	{ 0, 0, 0 },
+	BRANCH_SUPERINSTRUCTIONS(ExecuteCmp, REGISTER_DIRECT),
+	BRANCH_SUPERINSTRUCTIONS(ExecuteCmp, IMMEDIATELY),
+	BRANCH_SUPERINSTRUCTIONS(ExecuteTest, REGISTER_DIRECT),
+	BRANCH_SUPERINSTRUCTIONS(ExecuteTest, IMMEDIATELY),
+	BRANCH_SUPERINSTRUCTIONS(ExecuteAdd, REGISTER_DIRECT),
+	BRANCH_SUPERINSTRUCTIONS(ExecuteAdd, IMMEDIATELY),
+	BRANCH_SUPERINSTRUCTIONS(ExecuteSub, REGISTER_DIRECT),
+	BRANCH_SUPERINSTRUCTIONS(ExecuteSub, IMMEDIATELY),
+	MOVE_SUPERINSTRUCTIONS(REGISTER_DIRECT, REGISTER_DIRECT),
+	MOVE_SUPERINSTRUCTIONS(REGISTER_DIRECT, IMMEDIATELY),
+	MOVE_SUPERINSTRUCTIONS(IMMEDIATELY, REGISTER_DIRECT),
+	MOVE_SUPERINSTRUCTIONS(IMMEDIATELY, IMMEDIATELY),
+	SUPERINSTRUCTION(ONE_OPERAND_REGISTER_HANDLER(ExecutePush), ONE_OPERAND_REGISTER_HANDLER(ExecutePush)),
+	SUPERINSTRUCTION(ONE_OPERAND_REGISTER_HANDLER(ExecutePop), ONE_OPERAND_REGISTER_HANDLER(ExecutePop))
+} };
+
+// handlers with operands resolved at run time, used by switch and threaded dispatch
+template void CPU::ExecuteXchg<>();
+template void CPU::ExecuteInt<>();
+template void CPU::ExecuteMov<>();
+template void CPU::ExecuteAdd<>();
+template void CPU::ExecuteSub<>();
+template void CPU::ExecuteMul<>();
+template void CPU::ExecuteDiv<>();
+template void CPU::ExecuteCmp<>();
+template void CPU::ExecuteNot<>();
+template void CPU::ExecuteAnd<>();
+template void CPU::ExecuteOr<>();
+template void CPU::ExecuteXor<>();
+template void CPU::ExecuteTest<>();
+template void CPU::ExecuteShl<>();
+template void CPU::ExecuteShr<>();
+template void CPU::ExecutePush<>();
+template void CPU::ExecutePop<>();
+template void CPU::ExecuteJmp<>();
+template void CPU::ExecuteJeq<>();
+template void CPU::ExecuteJne<>();
+template void CPU::ExecuteJgt<>();
+template void CPU::ExecuteCall<>();
\ No newline at end of file
@@ -1,15 +1,25 @@
 #ifndef _CPU_EMULATOR_H
 #define _CPU_EMULATOR_H
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <utility>
+#include "../common/isa.h"
 #include "../common/structures.h"
+#include "device.h"
 #include "executable.h"
+#include "fusion.h"
 #include "interrupt.h"
+#include "interruptcontroller.h"
 #include "linker.h"
+#include "snapshot.h"
+
+// backward branch over at most this many bytes of constant moves into registers is an idle loop
+#define IDLE_LOOP_MAX_LENGTH 16
 
 #define FLAG_Z	0x0001
 #define FLAG_O	0x0002
@@ -22,67 +32,64 @@
 #define TERMINAL_DATA_OUT 0xFF00
 #define TERMINAL_DATA_IN  0xFF02
 #define TIMER_CFG 0xFF10
+// semihosting: guest stores buffer address and length, then SEMIHOST_WRITE into command register
+#define SEMIHOST_ADDRESS 0xFF20
+#define SEMIHOST_LENGTH  0xFF22
+#define SEMIHOST_COMMAND 0xFF24
+#define SEMIHOST_WRITE   0x01
+// DMA controller: writing mode register starts transfer, fill takes its byte from low byte of source register
+#define DMA_SOURCE		0xFF30
+#define DMA_DESTINATION	0xFF32
+#define DMA_LENGTH		0xFF34
+#define DMA_STRIDE		0xFF36
+#define DMA_MODE		0xFF38
+#define DMA_COPY		0x01
+#define DMA_FILL		0x02
+#define DMA_COPY_STRIDE	0x03
+// DMA interrupt is raised once transfer completes
+#define DMA_INTERRUPT	0x80
+// block storage: STORAGE_READ written into command register copies given sector of
+// disk image to buffer; status tells whether sector existed, sector count is read-only
+#define STORAGE_SECTOR		0xFF40
+#define STORAGE_BUFFER		0xFF42
+#define STORAGE_COMMAND		0xFF44
+#define STORAGE_STATUS		0xFF46
+#define STORAGE_SECTORS		0xFF48
+#define STORAGE_READ		0x01
+#define STORAGE_INTERRUPT	0x80
+#define STORAGE_OK			0x00
+#define STORAGE_ERROR		0x01
 
 #define PC_REGISTER 7
 
-// DO NOT CHANGE THE ORDER HERE
-enum InstructionMnemonic
+// template argument telling that operand size or addressing type is known only at run time
+#define DYNAMIC_OPERAND -1
+// specialized handler index: operation code (5 bits) | operand size (1 bit) | addressing types (2 x 3 bits)
+#define SPECIALIZED_HANDLERS_SIZE 4096
+// no superinstruction, register compare or arithmetic + conditional jump (72),
+// register move + arithmetic (40), push + push and pop + pop
+#define SUPERINSTRUCTIONS_SIZE 115
+
+class CPU;
+class CheckpointWriter;
+typedef void (CPU::*InstructionHandler)();
+
+// pair of specialized handlers and the handler running both of them
+struct Superinstruction
 {
-	HALT = 1,
-	XCHG,
-	INT,
-	MOV,
-	ADD,
-	SUB,
-	MUL,
-	DIV,
-	CMP,
-	NOT,
-	AND,
-	OR,
-	XOR,
-	TEST,
-	SHL,
-	SHR,
-	PUSH,
-	POP,
-	JMP,
-	JEQ,
-	JNE,
-	JGT,
-	CALL,
-	RET,
-	IRET
+	InstructionHandler first;
+	InstructionHandler second;
+	InstructionHandler fused;
 };
 
-static map<InstructionMnemonic, InstructionDetails> cpuInstructionsMap = {
-		{HALT, InstructionDetails(0, 1)},
-		{RET, InstructionDetails(0, 24)},
-		{IRET, InstructionDetails(0, 25)},
-
-		{INT, InstructionDetails(1, 3)},
-		{NOT, InstructionDetails(1, 10)},
-		{PUSH, InstructionDetails(1, 17)},
-		{POP, InstructionDetails(1, 18)},
-		{JMP, InstructionDetails(1, 19)},
-		{JEQ, InstructionDetails(1, 20)},
-		{JNE, InstructionDetails(1, 21)},
-		{JGT, InstructionDetails(1, 22)},
-		{CALL, InstructionDetails(1, 23)},
-
-		{XCHG, InstructionDetails(2, 2)},
-		{MOV, InstructionDetails(2, 4)},
-		{ADD, InstructionDetails(2, 5)},
-		{SUB, InstructionDetails(2, 6)},
-		{MUL, InstructionDetails(2, 7)},
-		{DIV, InstructionDetails(2, 8)},
-		{CMP, InstructionDetails(2, 9)},
-		{AND, InstructionDetails(2, 11)},
-		{OR, InstructionDetails(2, 12)},
-		{XOR, InstructionDetails(2, 13)},
-		{TEST, InstructionDetails(2, 14)},
-		{SHL, InstructionDetails(2, 15)},
-		{SHR, InstructionDetails(2, 16)}
+// operands of last operation that changed O or C, evaluated only when flag is read
+struct DeferredFlag
+{
+	bool pending = false;
+	InstructionMnemonic operation;
+	int16_t src;
+	int16_t dst;
+	int16_t r;
 };
 
 class CPU
@@ -109,6 +116,10 @@ private:
 	
 	// for checking if instruction is in executable section
 	uint16_t pcBeforeInstruction = 0;
+	// branch of an idle loop taken once; the loop body has surely run when it is taken again
+	int32_t idleLoopBranch = -1;
+	// stack pointer keyboard handler returns to, -1 if guest is not handling keyboard interrupt
+	int32_t keyboardReturnSP = -1;
 
 	AddressingType operand1AddressingType;
 	ByteSelector operand1ByteSelector;
@@ -120,13 +131,126 @@ private:
 	uint16_t operand2;
 	uint8_t registerSelector2;
 
+	// effective addresses of memory operands (-1 if operand is not in memory)
+	// needed to invalidate decoded instructions overwritten by the program
+	int32_t operand1Address;
+	int32_t operand2Address;
+
+	// false if decoding raised an interrupt, so the result must not be cached
+	bool decodeCacheable;
+
+	// superinstructions; table is set only when fusion or its training is enabled
+	FusionTable* fusionTable = 0;
+	uint16_t pcAfterDecode = 0;
+	// decoded second half of the superinstruction selected by the last fetch
+	const DecodedInstruction* superinstructionSecond;
+
+	// handler specialized for decoded operand size and addressing types
+	InstructionHandler instructionHandler;
+	static const array<InstructionHandler, SPECIALIZED_HANDLERS_SIZE> specializedHandlers;
+	// entry 0 stands for no superinstruction
+	static const array<Superinstruction, SUPERINSTRUCTIONS_SIZE> superinstructions;
+
+	template <int code, int size, int mode1, int mode2>
+	struct HandlerSelector;
+	template <size_t... indices>
+	static array<InstructionHandler, SPECIALIZED_HANDLERS_SIZE> MakeSpecializedHandlers(index_sequence<indices...>);
+	static inline uint16_t SpecializedHandlerIndex(uint8_t code, uint8_t size, uint8_t mode1, uint8_t mode2)
+	{
+		return ((code & 0x1F) << 7) | ((size & 0x01) << 6) | ((mode1 & 0x07) << 3) | (mode2 & 0x07);
+	}
+
 	void ResolveAddressing(uint8_t rawData, Operand op);
+	void LoadDecodedOperand(const DecodedInstruction& decoded, Operand op);
 	uint16_t& GetReference16(Operand op);
 	uint8_t& GetReference8(Operand op);
+	// compile time resolved counterparts of GetReference16/GetReference8
+	template <int size> inline bool IsWordOperation();
+	template <Operand op, int mode> inline uint16_t& Reference16();
+	template <Operand op, int mode> inline uint8_t& Reference8();
+	template <int mode> inline uint16_t& JumpTarget();
+	inline const uint8_t& GetMemoryOperand(Operand op, const uint16_t& address)
+	{
+		(op == Operand::FIRST_OPERAND ? operand1Address : operand2Address) = address;
+		if (address >= MEMORY_MAPPED_REGISTERS_START)
+			devices.Read(*this, address);
+		return memory_read(address);
+	}
+	inline void OperandByteWritten(const uint16_t& address)
+	{
+		if (address >= MEMORY_MAPPED_REGISTERS_START)
+			devices.Write(*this, address, memory_read(address));
+		else
+			executable->InvalidateDecoded(address);
+	}
+	void InvalidateWrittenOperands();
 
+	inline void LoadDecodedInstruction(const DecodedInstruction& decoded);
 	void InstructionFetchAndDecode();
+	void InstructionDecode();
+	void CacheDecodedInstruction();
+	// superinstructions table index for given pair, 0 if pair is not fused
+	uint8_t SuperinstructionIndex(const DecodedInstruction& first, const DecodedInstruction& second);
+	// for entries decoded without the fusion table, e.g. loaded from translation cache
+	void FormSuperinstructions();
+	bool InstructionPrologue();
 	void InstructionExecute();
+	void InstructionExecuteSpecialized();
+	void InstructionEpilogue();
+	void CheckIdleLoop();
+	// true if devices have to be polled after this instruction
+	inline bool InstructionEndsBatch()
+	{
+		if (++batchCount < batchSize && !pollNow && !halted && instructionCount < deviceDeadline && !EndsBatch(instructionMnemonic))
+			return false;
+
+		batchCount = 0;
+		pollNow = false;
+		return true;
+	}
+	static inline bool EndsBatch(InstructionMnemonic mnemonic)
+	{
+		return mnemonic == InstructionMnemonic::HALT || mnemonic == InstructionMnemonic::INT || mnemonic >= InstructionMnemonic::JMP;
+	}
 	void InstructionHandleInterrupt();
+	void ServiceDeadlines();
+	// budget counts from the current instruction
+	void StartBudget();
+	void SaveCheckpoint();
+	// sleeps until an interrupt psw does not mask can be taken
+	void WaitForInterrupt();
+
+	// semantics of each instruction, shared by all dispatch engines; template arguments
+	// select operand size and addressing types at compile time (DYNAMIC_OPERAND at run time)
+	void ExecuteHalt();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteXchg();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteInt();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteMov();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteAdd();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteSub();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteMul();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteDiv();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteCmp();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteNot();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteAnd();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteOr();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteXor();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteTest();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteShl();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteShr();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecutePush();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecutePop();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteJmp();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteJeq();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteJne();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteJgt();
+	template <int size = DYNAMIC_OPERAND, int mode1 = DYNAMIC_OPERAND, int mode2 = DYNAMIC_OPERAND> void ExecuteCall();
+	void ExecuteRet();
+	void ExecuteIret();
+	void ExecuteWait();
+	void ExecuteInvalid();
+	// both halves in one dispatch; fetch selects it only if interrupt check between them would find nothing to do
+	template <InstructionHandler first, InstructionHandler second> void ExecuteSuperinstruction();
 
 	inline void memory_push(const uint8_t& data) 
 	{ 
@@ -143,29 +267,85 @@ private:
 	inline void SetFlagO(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation);
 	inline void SetFlagC(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation);
 
+	// instructions only record what SetFlagsZN, SetFlagO and SetFlagC would get; Z, N, O
+	// and C in psw are brought up to date when they are read (jumps, INT, interrupt entry)
+	bool deferredZN = false;
+	int16_t deferredResult;
+	DeferredFlag deferredO;
+	DeferredFlag deferredC;
+
+	inline void DeferFlagsZN(int16_t result) { deferredZN = true; deferredResult = result; }
+	inline void DeferFlagO(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation);
+	inline void DeferFlagC(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation);
+	inline void EvaluateFlagO();
+	inline void EvaluateFlagC();
+	// must be called before psw is read as a whole
+	void EvaluateFlags();
+	// must be called before psw is overwritten as a whole
+	inline void DiscardDeferredFlags() { deferredZN = false; deferredO.pending = false; deferredC.pending = false; }
+	// O and C bits SetFlagO and SetFlagC produce for given operands, psw is left unchanged
+	uint16_t ArithmeticFlags(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation);
+
 	// interrupts
 	mutex emulatorStatusMutex;
 	mutex memoryMutex;
-	priority_queue <InterruptType, vector<InterruptType>, less<InterruptType>> interruptRequests;
-	thread* keyboardThread;
-	thread* timerThread;
-
-	inline bool GetZ() { return psw & FLAG_Z; }
-	inline bool GetO() { return psw & FLAG_O; }
-	inline bool GetC() { return psw & FLAG_C; }
-	inline bool GetN() { return psw & FLAG_N; }
+	InterruptController interrupts;
+	DeviceBus devices;
+	TerminalDevice terminal;
+	TimerDevice timer;
+	SemihostDevice semihost;
+	DMAController dma;
+	StorageDevice storage;
+	// virtual time, timer interrupt is raised and input is delivered once it reaches their deadlines
+	uint64_t instructionCount = 0;
+	uint64_t timerDeadline = UINT64_MAX;
+	uint64_t inputDeadline = UINT64_MAX;
+	// processor halts once it has executed budget instructions after initialization, 0 for no limit
+	uint64_t instructionBudget = 0;
+	uint64_t budgetDeadline = UINT64_MAX;
+	bool budgetExhausted = false;
+	// checkpoint is taken at the first instruction boundary after its deadline
+	CheckpointWriter* checkpointWriter = 0;
+	uint64_t checkpointInterval = 0;
+	uint64_t checkpointDeadline = UINT64_MAX;
+	bool checkpointDue = false;
+	// earliest of the deadlines
+	uint64_t deviceDeadline = UINT64_MAX;
+	inline void UpdateDeviceDeadline() { deviceDeadline = min(min(budgetDeadline, checkpointDeadline), min(timerDeadline, inputDeadline)); }
+	// false if keyboard input must not be taken from console
+	bool keyboardEnabled = true;
+	EventLoop* eventLoop = 0;
+
+	// devices are polled after this many instructions, or sooner if control is transferred
+	uint16_t batchSize = 1;
+	uint16_t batchCount = 0;
+	// set by processor itself (invalid instruction), ends batch right away
+	bool pollNow = false;
+
+	inline bool GetZ() { return deferredZN ? deferredResult == 0 : (psw & FLAG_Z) != 0; }
+	inline bool GetO() { EvaluateFlagO(); return psw & FLAG_O; }
+	inline bool GetC() { EvaluateFlagC(); return psw & FLAG_C; }
+	inline bool GetN() { return deferredZN ? deferredResult < 0 : (psw & FLAG_N) != 0; }
 	inline bool GetTr() { return psw & FLAG_Tr; }
 	inline bool GetTl() { return psw & FLAG_Tl; }
 	inline bool GetI() { return psw & FLAG_I; }
 
 
 public:
+	CPU();
 	~CPU();
 	
-	void StartThreads();
-	inline thread& GetKeyboardThread() { return *keyboardThread; }
+	void StartEventLoop();
+	// must be called at an instruction boundary, from thread that runs processor; state saved
+	// without tracking writes does not disturb restoring of earlier snapshots (e.g. checkpoints)
+	void SaveState(Snapshot& snapshot, bool trackWrites = true);
+	void RestoreState(const Snapshot& snapshot);
+	// event loop writes memory, so it has to finish before executable is released
+	void StopEventLoop();
 	inline mutex& GetEmulatorStatusMutex() { return emulatorStatusMutex; }
 	inline mutex& GetMemoryMutex() { return memoryMutex; }
+	inline const TimerDevice& GetTimer() { return timer; }
+	inline TerminalDevice& GetTerminal() { return terminal; }
 	inline const bool& GetHaltedStatus() { return halted; }
 
 	void WriteIO(const uint16_t& address, const uint8_t& data);
@@ -176,8 +356,136 @@ public:
 	inline const uint8_t& memory_read(const uint16_t& address) { return executable->MemoryRead(address); }
 	const uint16_t memory_read_16(const uint16_t& address);
 	inline void memory_write(const uint16_t& address, const uint8_t& data) { executable->MemoryWrite(address, data, false); }
+	inline void memory_copy(const uint16_t& destination, const uint16_t& source, const uint16_t& length, const uint16_t& stride) { executable->MemoryCopy(destination, source, length, stride); }
+	inline void memory_load(const uint16_t& destination, const uint8_t* data, const uint16_t& length) { executable->MemoryLoad(destination, data, length); }
+	inline void memory_fill(const uint16_t& destination, const uint8_t& data, const uint16_t& length) { executable->MemoryFill(destination, data, length); }
 
 	friend class Emulator;
+	friend class ThreadedInterpreter;
+	friend class TranslationCache;
+	friend class JITCompiler;
+	friend class AOTRuntime;
 };
 
+// flag helpers are defined here so translated code compiled outside cpu.cpp shares them
+inline void CPU::SetFlagsZN(uint8_t flags, int16_t result)
+{
+	if ((flags & FLAG_Z) && (result == 0))
+		psw = psw | FLAG_Z;
+	else
+		psw = psw & (~(int16_t)FLAG_Z);
+
+	if ((flags & FLAG_N) && (result < 0))
+		psw = psw | FLAG_N;
+	else
+		psw = psw & (~(int16_t)FLAG_N);
+}
+
+inline void CPU::SetFlagO(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation)
+{
+	switch (operation)
+	{
+	case InstructionMnemonic::ADD:
+	{
+		if ((src >= 0 && dst >= 0 && r < 0) || (src < 0 && dst < 0 && r >= 0))
+			psw = psw | FLAG_O;
+		else
+			psw = psw & (~(int16_t)FLAG_O);
+		break;
+	}
+	case InstructionMnemonic::SUB:
+	{
+		// PSWC i PSWV - by Hadzic ORT2
+		if ((src >= 0 && dst < 0 && r < 0) || (src < 0 && dst >= 0 && r >= 0))
+			psw = psw | FLAG_O;
+		else
+			psw = psw & (~(int16_t)FLAG_O);
+		break;
+	}
+	}
+}
+
+inline void CPU::SetFlagC(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation)
+{
+	switch (operation)
+	{
+	case InstructionMnemonic::ADD:
+	{
+		if ((src >= 0 && dst >= 0) || (src >= 0 && dst < 0 && r < 0) || (src < 0 && dst >= 0 && r < 0))
+			psw = psw | FLAG_C;
+		else
+			psw = psw & (~(int16_t)FLAG_C);
+		break;
+	}
+	case InstructionMnemonic::SUB:
+	case InstructionMnemonic::CMP:
+	{
+		if ((src >= 0 && dst < 0 && r < 0) || (src >= 0 && dst >= 0 && r >= 0) || (src < 0 && dst >= 0 && r >= 0))
+			psw = psw | FLAG_C;
+		else
+			psw = psw & (~(int16_t)FLAG_C);
+		break;
+	}
+	case InstructionMnemonic::SHL:
+	case InstructionMnemonic::SHR:
+	{
+		int16_t r = dst;
+		for (int i = 1; i <= src; i++)
+		{
+			if (r < 0)
+				psw = psw | FLAG_C;
+			else
+				psw = psw & (~(int16_t)FLAG_C);
+
+			if (operation == InstructionMnemonic::SHL)
+				r = r << 1;
+			else
+				r = r >> 1;
+		}
+
+		break;
+	}
+	}
+}
+
+inline void CPU::DeferFlagO(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation)
+{
+	// SetFlagO leaves O unchanged for other operations, so their operands must not replace pending ones
+	if (operation != InstructionMnemonic::ADD && operation != InstructionMnemonic::SUB)
+		return;
+
+	deferredO.pending = true;
+	deferredO.operation = operation;
+	deferredO.src = src;
+	deferredO.dst = dst;
+	deferredO.r = r;
+}
+
+inline void CPU::DeferFlagC(int16_t src, int16_t dst, int16_t r, InstructionMnemonic operation)
+{
+	deferredC.pending = true;
+	deferredC.operation = operation;
+	deferredC.src = src;
+	deferredC.dst = dst;
+	deferredC.r = r;
+}
+
+inline void CPU::EvaluateFlagO()
+{
+	if (!deferredO.pending)
+		return;
+
+	SetFlagO(deferredO.src, deferredO.dst, deferredO.r, deferredO.operation);
+	deferredO.pending = false;
+}
+
+inline void CPU::EvaluateFlagC()
+{
+	if (!deferredC.pending)
+		return;
+
+	SetFlagC(deferredC.src, deferredC.dst, deferredC.r, deferredC.operation);
+	deferredC.pending = false;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "decodecache.h"
+
+DecodedInstructionCache::~DecodedInstructionCache()
+{
+	for (int i = 0; i < DECODE_CACHE_NUMBER_OF_PAGES; i++)
+		delete[] pages[i];
+}
+
+void DecodedInstructionCache::Insert(const uint16_t& pc, const DecodedInstruction& instruction)
+{
+	uint16_t page = pc / DECODE_CACHE_PAGE_SIZE;
+	if (!pages[page])
+		pages[page] = new DecodedInstruction[DECODE_CACHE_PAGE_SIZE];
+
+	DecodedInstruction& entry = pages[page][pc % DECODE_CACHE_PAGE_SIZE];
+	if (!entry.valid)
+		validEntries[page]++;
+
+	entry = instruction;
+	entry.valid = true;
+}
+
+void DecodedInstructionCache::Invalidate(const uint16_t& address)
+{
+	// every instruction that starts in [address - MAX_INSTRUCTION_LENGTH + 1, address]
+	// could contain the written byte
+	for (int i = 0; i < MAX_INSTRUCTION_LENGTH; i++)
+	{
+		uint16_t pc = address - i;
+		uint16_t page = pc / DECODE_CACHE_PAGE_SIZE;
+
+		if (validEntries[page] == 0)
+			continue;
+
+		DecodedInstruction& entry = pages[page][pc % DECODE_CACHE_PAGE_SIZE];
+		if (entry.valid && pc + entry.length > address)
+		{
+			entry.valid = false;
+			validEntries[page]--;
+			UnfusePredecessors(pc);
+		}
+	}
+}
+
+void DecodedInstructionCache::UnfusePredecessors(const uint16_t& pc)
+{
+	for (int length = 1; length <= MAX_INSTRUCTION_LENGTH; length++)
+	{
+		uint16_t previous = pc - length;
+		DecodedInstruction* page = pages[previous / DECODE_CACHE_PAGE_SIZE];
+
+		if (page && page[previous % DECODE_CACHE_PAGE_SIZE].valid && page[previous % DECODE_CACHE_PAGE_SIZE].length == length)
+			page[previous % DECODE_CACHE_PAGE_SIZE].superinstruction = 0;
+	}
+}
+
+void DecodedInstructionCache::Clear()
+{
+	for (int i = 0; i < DECODE_CACHE_NUMBER_OF_PAGES; i++)
+	{
+		delete[] pages[i];
+		pages[i] = 0;
+		validEntries[i] = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef _DECODECACHE_EMULATOR_H
+#define _DECODECACHE_EMULATOR_H
+
+#include "../common/enums.h"
+#include <cstdint>
+
+#define DECODE_CACHE_PAGE_SIZE 256
+#define DECODE_CACHE_NUMBER_OF_PAGES 256
+// InstrDescr + 2 * (OpDescr + Im/Di/Ad)
+#define MAX_INSTRUCTION_LENGTH 7
+
+struct DecodedInstruction
+{
+	bool valid = false;
+	// number of bytes instruction occupies in memory
+	uint8_t length;
+
+	uint8_t instructionCode;
+	OperandSize operandSize;
+	// index into CPU specialized handlers table
+	uint16_t handlerIndex;
+	// index into CPU superinstructions table if instruction and the one following
+	// it in memory run as one superinstruction, 0 otherwise
+	uint8_t superinstruction = 0;
+
+	AddressingType operand1AddressingType;
+	ByteSelector operand1ByteSelector;
+	uint16_t operand1;
+	uint8_t registerSelector1;
+
+	AddressingType operand2AddressingType;
+	ByteSelector operand2ByteSelector;
+	uint16_t operand2;
+	uint8_t registerSelector2;
+};
+
+class DecodedInstructionCache
+{
+
+private:
+	// pages are allocated on first insertion into them
+	DecodedInstruction* pages[DECODE_CACHE_NUMBER_OF_PAGES] = {};
+	// number of valid entries in each page; used to skip writes to pages without code
+	uint16_t validEntries[DECODE_CACHE_NUMBER_OF_PAGES] = {};
+
+	// instruction ending where the invalidated one starts must not run it as its second half
+	void UnfusePredecessors(const uint16_t& pc);
+
+public:
+	~DecodedInstructionCache();
+
+	inline const DecodedInstruction* Lookup(const uint16_t& pc)
+	{
+		DecodedInstruction* page = pages[pc / DECODE_CACHE_PAGE_SIZE];
+		if (page && page[pc % DECODE_CACHE_PAGE_SIZE].valid)
+			return &page[pc % DECODE_CACHE_PAGE_SIZE];
+
+		return 0;
+	}
+	void Insert(const uint16_t& pc, const DecodedInstruction& instruction);
+	inline void SetSuperinstruction(const uint16_t& pc, uint8_t superinstruction)
+	{
+		DecodedInstruction* page = pages[pc / DECODE_CACHE_PAGE_SIZE];
+		if (page && page[pc % DECODE_CACHE_PAGE_SIZE].valid)
+			page[pc % DECODE_CACHE_PAGE_SIZE].superinstruction = superinstruction;
+	}
+	void Invalidate(const uint16_t& address);
+	void Clear();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "device.h"
+#include "cpu.h"
+#include <algorithm>
+#include <iostream>
+
+void DeviceBus::Map(Device* device, uint16_t start, uint16_t length)
+{
+	for (uint32_t address = start; address < (uint32_t)start + length && address <= MEMORY_MAPPED_REGISTERS_END; address++)
+	{
+		if (address >= MEMORY_MAPPED_REGISTERS_START)
+			devices[address - MEMORY_MAPPED_REGISTERS_START] = device;
+	}
+}
+
+void TerminalDevice::Write(CPU& /* processor */, uint16_t address, uint8_t data)
+{
+	if (address != TERMINAL_DATA_OUT || data == 0)
+		return;
+
+	if (!buffered)
+	{
+		*out << (char)data;
+		return;
+	}
+
+	output.push_back((char)data);
+	if (output.size() >= TERMINAL_OUTPUT_BUFFER_SIZE)
+		Flush();
+}
+
+void TerminalDevice::UseBufferedOutput()
+{
+	buffered = true;
+	output.reserve(TERMINAL_OUTPUT_BUFFER_SIZE);
+}
+
+void TerminalDevice::Print(const char* data, size_t length)
+{
+	if (buffered && output.size() + length <= TERMINAL_OUTPUT_BUFFER_SIZE)
+	{
+		output.append(data, length);
+		return;
+	}
+
+	Flush();
+	out->write(data, length);
+}
+
+void TerminalDevice::Flush()
+{
+	if (output.empty())
+		return;
+
+	out->write(output.data(), output.size());
+	out->flush();
+	output.clear();
+}
+
+void TerminalDevice::UseInput(const string& fileName, uint32_t rate)
+{
+	CloseInput();
+	if (fileName == "-")
+		input = &cin;
+	else
+	{
+		inputFile.open(fileName, ios::binary);
+		if (!inputFile.is_open())
+			throw EmulatorException("Cannot open input file '" + fileName + "'.", ErrorCodes::IO_INPUT_EXCEPTION);
+		input = &inputFile;
+	}
+
+	inputRate = (rate == 0 ? 1 : rate);
+}
+
+void TerminalDevice::CloseInput()
+{
+	input = 0;
+	if (inputFile.is_open())
+		inputFile.close();
+	inputFile.clear();
+}
+
+bool TerminalDevice::DeliverInput(CPU& processor)
+{
+	char c;
+	// NOTE: lines are ended with '\n (0x0a ascii)', it is not delivered, same as with keyboard
+	while (input->get(c))
+	{
+		if (c == '\n')
+			continue;
+
+		processor.WriteIO(TERMINAL_DATA_IN, c);
+		processor.SetInterrupt(InterruptType::KEYBOARD);
+		return true;
+	}
+
+	return false;
+}
+
+void TerminalDevice::DeliverKeyboard(CPU& processor)
+{
+	keyboardInService = !keyboardQueue.empty();
+	if (!keyboardInService)
+		return;
+
+	processor.WriteIO(TERMINAL_DATA_IN, keyboardQueue.front());
+	keyboardQueue.pop_front();
+	processor.SetInterrupt(InterruptType::KEYBOARD);
+}
+
+void TerminalDevice::QueueKeyboard(CPU& processor, const char* data, size_t length)
+{
+	lock_guard<mutex> guard(keyboardMutex);
+
+	// NOTE: lines are ended with '\n (0x0a ascii)', it is not delivered
+	for (size_t i = 0; i < length; i++)
+	{
+		if (data[i] != '\n')
+			keyboardQueue.push_back(data[i]);
+	}
+
+	if (!keyboardInService)
+		DeliverKeyboard(processor);
+}
+
+void TerminalDevice::KeyboardHandled(CPU& processor)
+{
+	lock_guard<mutex> guard(keyboardMutex);
+	DeliverKeyboard(processor);
+}
+
+void SemihostDevice::Write(CPU& processor, uint16_t address, uint8_t data)
+{
+	if (address != SEMIHOST_COMMAND || data != SEMIHOST_WRITE)
+		return;
+
+	uint16_t start = processor.memory_read_16(SEMIHOST_ADDRESS);
+	uint32_t length = processor.memory_read_16(SEMIHOST_LENGTH);
+	// span is cut at the end of address space
+	if (start + length > MEMORY_ADDRESS_SPACE)
+		length = MEMORY_ADDRESS_SPACE - start;
+
+	processor.GetTerminal().Print((const char*)&processor.memory_read(start), length);
+}
+
+void DMAController::Write(CPU& processor, uint16_t address, uint8_t data)
+{
+	if (address != DMA_MODE)
+		return;
+
+	uint16_t source = processor.memory_read_16(DMA_SOURCE);
+	uint16_t destination = processor.memory_read_16(DMA_DESTINATION);
+	uint16_t length = processor.memory_read_16(DMA_LENGTH);
+
+	switch (data & ~DMA_INTERRUPT)
+	{
+	case DMA_COPY:
+		processor.memory_copy(destination, source, length, 1);
+		break;
+	case DMA_FILL:
+		processor.memory_fill(destination, (uint8_t)source, length);
+		break;
+	case DMA_COPY_STRIDE:
+		processor.memory_copy(destination, source, length, processor.memory_read_16(DMA_STRIDE));
+		break;
+	default:
+		// unknown modes do nothing
+		return;
+	}
+
+	if (data & DMA_INTERRUPT)
+		processor.SetInterrupt(InterruptType::DMA);
+}
+
+void StorageDevice::UseImage(const string& fileName)
+{
+	if (!image.Open(fileName))
+		throw EmulatorException("Cannot open disk image '" + fileName + "'.", ErrorCodes::IO_INPUT_EXCEPTION);
+}
+
+void StorageDevice::Read(CPU& processor, uint16_t address)
+{
+	if (address != STORAGE_SECTORS && address != STORAGE_SECTORS + 1)
+		return;
+
+	// images larger than 32 MB are seen only up to the last addressable sector
+	uint16_t sectors = (uint16_t)min(NumberOfSectors(), (uint32_t)UINT16_MAX);
+	processor.memory_write(STORAGE_SECTORS, sectors & 0xFF);
+	processor.memory_write(STORAGE_SECTORS + 1, sectors >> 8);
+}
+
+void StorageDevice::Write(CPU& processor, uint16_t address, uint8_t data)
+{
+	if (address != STORAGE_COMMAND || (data & ~STORAGE_INTERRUPT) != STORAGE_READ)
+		return;
+
+	uint16_t sector = processor.memory_read_16(STORAGE_SECTOR);
+	uint16_t buffer = processor.memory_read_16(STORAGE_BUFFER);
+
+	if (sector < NumberOfSectors())
+	{
+		size_t offset = (size_t)sector * STORAGE_SECTOR_SIZE;
+		uint16_t length = (uint16_t)min((size_t)STORAGE_SECTOR_SIZE, image.Size() - offset);
+
+		processor.memory_load(buffer, image.Data() + offset, length);
+		if (length < STORAGE_SECTOR_SIZE)
+			processor.memory_fill(buffer + length, 0, STORAGE_SECTOR_SIZE - length);
+		processor.memory_write(STORAGE_STATUS, STORAGE_OK);
+	}
+	else
+		processor.memory_write(STORAGE_STATUS, STORAGE_ERROR);
+
+	if (data & STORAGE_INTERRUPT)
+		processor.SetInterrupt(InterruptType::STORAGE);
+}
+
+void TimerDevice::Write(CPU& /* processor */, uint16_t address, uint8_t data)
+{
+	// unknown configurations leave period unchanged
+	if (address == TIMER_CFG && data < TIMER_NUMBER_OF_PERIODS)
+		configuration.store(data, memory_order_relaxed);
+}
+
+uint16_t TimerDevice::PeriodMs() const
+{
+	static const uint16_t periods[TIMER_NUMBER_OF_PERIODS] = { 500, 1000, 1500, 2000, 5000, 10000, 30000, 60000 };
+
+	return periods[configuration.load(memory_order_relaxed)];
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#ifndef _DEVICE_EMULATOR_H
+#define _DEVICE_EMULATOR_H
+
+#include "linker.h"
+#include "mappedfile.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+using namespace std;
+
+#define DEVICE_BUS_SIZE (MEMORY_MAPPED_REGISTERS_END - MEMORY_MAPPED_REGISTERS_START + 1)
+#define TIMER_NUMBER_OF_PERIODS 8
+#define TERMINAL_OUTPUT_BUFFER_SIZE 65536
+#define STORAGE_SECTOR_SIZE 512
+
+class CPU;
+
+// device occupying some of memory mapped registers; register contents are kept
+// in guest memory, callbacks only react to processor accessing them
+class Device
+{
+
+public:
+	virtual ~Device() {}
+
+	// called before processor reads register, may update its contents
+	virtual void Read(CPU& /* processor */, uint16_t /* address */) {}
+	// called after processor has stored data into register
+	virtual void Write(CPU& /* processor */, uint16_t /* address */, uint8_t /* data */) {}
+};
+
+// decodes addresses of memory mapped registers (0xFF00-0xFFFF) to devices,
+// ordinary memory accesses never get here
+class DeviceBus
+{
+
+private:
+	Device* devices[DEVICE_BUS_SIZE] = {};
+
+public:
+	// bus does not take ownership of the device
+	void Map(Device* device, uint16_t start, uint16_t length);
+
+	inline void Read(CPU& processor, uint16_t address)
+	{
+		Device* device = devices[address - MEMORY_MAPPED_REGISTERS_START];
+		if (device)
+			device->Read(processor, address);
+	}
+	inline void Write(CPU& processor, uint16_t address, uint8_t data)
+	{
+		Device* device = devices[address - MEMORY_MAPPED_REGISTERS_START];
+		if (device)
+			device->Write(processor, address, data);
+	}
+};
+
+// prints characters stored into TERMINAL_DATA_OUT; in headless mode output is
+// collected and written in chunks, and keyboard input is read from a stream
+class TerminalDevice : public Device
+{
+
+private:
+	bool buffered = false;
+	string output;
+	ostream* out = &cout;
+
+	istream* input = 0;
+	ifstream inputFile;
+	// one character is delivered every inputRate executed instructions
+	uint32_t inputRate = 0;
+
+	// characters typed on console wait here while guest handles the one before them
+	deque<char> keyboardQueue;
+	bool keyboardInService = false;
+	mutex keyboardMutex;
+	void DeliverKeyboard(CPU& processor);
+
+public:
+	~TerminalDevice() { Flush(); }
+
+	void Write(CPU& processor, uint16_t address, uint8_t data) override;
+
+	void UseBufferedOutput();
+	// stream has to outlive the device
+	inline void UseOutput(ostream& stream) { out = &stream; }
+	// whole span goes to output at once, in order with single characters
+	void Print(const char* data, size_t length);
+	void Flush();
+
+	// "-" stands for standard input
+	void UseInput(const string& fileName, uint32_t rate);
+	void CloseInput();
+	inline bool HasInput() const { return input != 0; }
+	inline uint32_t InputRate() const { return inputRate; }
+	// delivers next character as keyboard interrupt, false once input is exhausted
+	bool DeliverInput(CPU& processor);
+
+	// called from event loop; first character is delivered at once unless guest is handling one
+	void QueueKeyboard(CPU& processor, const char* data, size_t length);
+	// called once guest's keyboard handler has returned, delivers next queued character
+	void KeyboardHandled(CPU& processor);
+};
+
+// prints a span of guest memory with one host write
+class SemihostDevice : public Device
+{
+
+public:
+	void Write(CPU& processor, uint16_t address, uint8_t data) override;
+};
+
+// copies or fills guest memory on host as soon as mode register is written,
+// transfer is finished before the next instruction executes
+class DMAController : public Device
+{
+
+public:
+	void Write(CPU& processor, uint16_t address, uint8_t data) override;
+};
+
+// reads sectors of a disk image mapped into host memory; last sector is
+// padded with zeros if image size is not a multiple of sector size
+class StorageDevice : public Device
+{
+
+private:
+	MappedFile image;
+
+public:
+	void Read(CPU& processor, uint16_t address) override;
+	void Write(CPU& processor, uint16_t address, uint8_t data) override;
+
+	void UseImage(const string& fileName);
+	inline uint32_t NumberOfSectors() const { return (uint32_t)((image.Size() + STORAGE_SECTOR_SIZE - 1) / STORAGE_SECTOR_SIZE); }
+};
+
+// keeps period selected through TIMER_CFG for timer thread, or for processor
+// when time is measured in executed instructions
+class TimerDevice : public Device
+{
+
+private:
+	atomic<uint8_t> configuration{ 0 };
+	// 0 if timer runs in real time
+	uint32_t instructionsPerMs = 0;
+
+public:
+	void Write(CPU& processor, uint16_t address, uint8_t data) override;
+	uint16_t PeriodMs() const;
+	inline uint8_t Configuration() const { return configuration.load(memory_order_relaxed); }
+	inline void Configure(uint8_t configuration) { this->configuration.store(configuration, memory_order_relaxed); }
+
+	inline void UseVirtualTime(uint32_t instructionsPerMs) { this->instructionsPerMs = instructionsPerMs; }
+	inline bool IsVirtual() const { return instructionsPerMs != 0; }
+	inline uint64_t PeriodInstructions() const { return (uint64_t)PeriodMs() * instructionsPerMs; }
+};
+
+#endif
\ No newline at end of file
@@ -1,37 +1,229 @@
 #include "emulator.h"
 
+Emulator::Emulator(Executable* executable, ExecutionEngine engine) : executable(executable), engine(engine)
+{
+	if (engine == ExecutionEngine::JIT_DISPATCH)
+	{
+		jit = new JITCompiler(processor, executable);
+		executable->jit = jit;
+	}
+}
+
 Emulator::~Emulator()
 {
+	processor.StopEventLoop();
+
+	delete checkpointWriter;
+	delete fusionTable;
+	delete translationCache;
+	delete jit;
+	delete aot;
 	delete executable;
 }
 
+void Emulator::UseFusionTable(const string& fileName, bool training)
+{
+	delete fusionTable;
+	fusionTable = new FusionTable(training);
+	fusionTableFile = fileName;
+
+	if (!training)
+		fusionTable->Load(fileName);
+	processor.fusionTable = fusionTable;
+}
+
+void Emulator::UseTranslationCache(const string& fileName)
+{
+	delete translationCache;
+	translationCache = new TranslationCache(fileName);
+}
+
+void Emulator::UseAOTProgram(const AOTProgram& program)
+{
+	delete aot;
+	aot = new AOTRuntime(processor, program);
+	executable->aot = aot;
+	engine = ExecutionEngine::AOT_DISPATCH;
+}
+
+void Emulator::SetBatchSize(uint16_t size)
+{
+	processor.batchSize = (size == 0 ? 1 : size);
+}
+
+void Emulator::UseVirtualTimer(uint32_t instructionsPerMs)
+{
+	processor.timer.UseVirtualTime(instructionsPerMs);
+}
+
+void Emulator::UseHeadlessMode()
+{
+	processor.terminal.UseBufferedOutput();
+	processor.keyboardEnabled = false;
+}
+
+void Emulator::UseInputFile(const string& fileName, uint32_t rate)
+{
+	processor.terminal.UseInput(fileName, rate);
+}
+
+void Emulator::CloseInputFile()
+{
+	processor.terminal.CloseInput();
+}
+
+void Emulator::UseDiskImage(const string& fileName)
+{
+	processor.storage.UseImage(fileName);
+}
+
+void Emulator::UseOutput(ostream& stream)
+{
+	processor.terminal.UseOutput(stream);
+}
+
+void Emulator::UseCheckpoints(const string& fileName, uint64_t interval)
+{
+	delete checkpointWriter;
+	checkpointWriter = new CheckpointWriter(fileName, *executable);
+	processor.checkpointWriter = checkpointWriter;
+	processor.checkpointInterval = (interval == 0 ? 1 : interval);
+}
+
+void Emulator::SetInstructionBudget(uint64_t instructions)
+{
+	processor.instructionBudget = instructions;
+}
+
+inline void Emulator::LoadTranslationCache()
+{
+	processor.executable = this->executable;
+	if (!translationCache)
+		return;
+
+	// cached entries carry no superinstructions, they are formed for fusion table of this run
+	translationCache->Load(executable, jit);
+	processor.FormSuperinstructions();
+}
+
 inline void Emulator::InitializeCPU()
 {
 	processor.executable = this->executable;
+	// translated code reads registers through register indirect sources without device bus,
+	// so sector count is put there before the program runs
+	processor.storage.Read(processor, STORAGE_SECTORS);
 
 	processor.pc = processor.memory_read_16(0);
+	processor.halted = false;
 	Run();
 	// initial stack pointer is set by interrupt vector #0
 	// processor.sp = 0xFFFF;
 	processor.pc = executable->initialPC;
+	processor.DiscardDeferredFlags();
 	processor.psw = FLAG_I | FLAG_Tl | FLAG_Tr;
 	processor.initializationFinished = true;
 	processor.halted = false;
-	processor.StartThreads();
 }
 
 inline void Emulator::Run()
 {
-	while (!processor.halted)
+	switch (engine)
 	{
-		processor.InstructionFetchAndDecode();
-		processor.InstructionExecute();
-		processor.InstructionHandleInterrupt();
+	case ExecutionEngine::THREADED_DISPATCH:
+		ThreadedInterpreter::Run(processor);
+		break;
+	case ExecutionEngine::JIT_DISPATCH:
+		jit->Run();
+		break;
+	case ExecutionEngine::AOT_DISPATCH:
+		aot->Run();
+		break;
+	case ExecutionEngine::SPECIALIZED_DISPATCH:
+		while (!processor.halted)
+		{
+			processor.InstructionFetchAndDecode();
+			processor.InstructionExecuteSpecialized();
+			if (processor.InstructionEndsBatch())
+				processor.InstructionHandleInterrupt();
+		}
+		break;
+	default:
+		while (!processor.halted)
+		{
+			processor.InstructionFetchAndDecode();
+			processor.InstructionExecute();
+			if (processor.InstructionEndsBatch())
+				processor.InstructionHandleInterrupt();
+		}
+		break;
 	}
 }
 
 void Emulator::Start()
 {
+	Boot();
+	processor.StartEventLoop();
+	Run();
+	Finish();
+}
+
+void Emulator::Boot()
+{
+	LoadTranslationCache();
 	InitializeCPU();
+}
+
+void Emulator::Continue()
+{
+	processor.StartEventLoop();
+	Run();
+	processor.StopEventLoop();
+
+	processor.terminal.Flush();
+}
+
+void Emulator::StartFromSnapshot(const Snapshot& snapshot)
+{
+	LoadTranslationCache();
+	processor.RestoreState(snapshot);
+	// snapshot taken when budget ran out continues with budget of this run
+	if (processor.budgetExhausted)
+		processor.halted = false;
+	processor.StartEventLoop();
+
+	Run();
+	Finish();
+}
+
+void Emulator::Finish()
+{
+	if (translationCache)
+		translationCache->Save(executable, jit);
+
+	if (fusionTable && fusionTable->IsTraining())
+		fusionTable->Save(fusionTableFile);
+
+	processor.terminal.Flush();
+}
+
+void Emulator::Resume()
+{
+	if (processor.halted && !processor.budgetExhausted)
+		return;
+
+	processor.halted = false;
+	processor.StartBudget();
 	Run();
+
+	processor.terminal.Flush();
+}
+
+void Emulator::TakeSnapshot(Snapshot& snapshot)
+{
+	processor.SaveState(snapshot);
+}
+
+void Emulator::RestoreSnapshot(const Snapshot& snapshot)
+{
+	processor.RestoreState(snapshot);
 }
\ No newline at end of file
@@ -1,27 +1,102 @@
 #ifndef _EMULATOR_EMULATOR_H
 #define _EMULATOR_EMULATOR_H
 
+#include "aot.h"
+#include "checkpoint.h"
 #include "cpu.h"
 #include "executable.h"
+#include "jit.h"
 #include "linker.h"
+#include "threaded.h"
+#include "translationcache.h"
 #include <thread>
 using namespace std;
 
+enum ExecutionEngine
+{
+	SWITCH_DISPATCH = 0,
+	THREADED_DISPATCH,
+	SPECIALIZED_DISPATCH,
+	JIT_DISPATCH,
+	AOT_DISPATCH
+};
+
 class Emulator
 {
 
 private:
 	CPU processor;
 	Executable* executable;
+	ExecutionEngine engine;
+	// created only for JIT_DISPATCH engine
+	JITCompiler* jit = 0;
+	// created only for AOT_DISPATCH engine
+	AOTRuntime* aot = 0;
+	TranslationCache* translationCache = 0;
+	FusionTable* fusionTable = 0;
+	string fusionTableFile;
+	CheckpointWriter* checkpointWriter = 0;
 
+	inline void LoadTranslationCache();
 	inline void InitializeCPU();
 	inline void Run();
 
 public:
-	Emulator(Executable* executable) : executable(executable) {}
+	Emulator(Executable* executable, ExecutionEngine engine = ExecutionEngine::SWITCH_DISPATCH);
 	~Emulator();
 
+	// superinstructions are formed from pairs listed in given file and run by specialized
+	// dispatch (and interpreted code of jit and aot), or pair frequencies are gathered
+	// and written to it when training
+	void UseFusionTable(const string& fileName, bool training);
+	// decoded and translated code is loaded from and saved to given file
+	void UseTranslationCache(const string& fileName);
+	// compiled blocks of translated program run instead of interpreting them
+	void UseAOTProgram(const AOTProgram& program);
+	// switch and specialized dispatch poll devices only after given number of
+	// instructions, or sooner on control transfer
+	void SetBatchSize(uint16_t size);
+	// timer periods are measured in executed instructions instead of wall clock time,
+	// so timer interrupts arrive at the same instructions in every run
+	void UseVirtualTimer(uint32_t instructionsPerMs);
+	// terminal output is written in large chunks and console is not read
+	void UseHeadlessMode();
+	// keyboard input is taken from given file ("-" for standard input), one
+	// character every given number of executed instructions
+	void UseInputFile(const string& fileName, uint32_t rate);
+	// keyboard input is no longer taken from a file
+	void CloseInputFile();
+	// sectors of given file are read by storage device
+	void UseDiskImage(const string& fileName);
+	// terminal output goes to given stream instead of console; stream has to outlive emulator
+	void UseOutput(ostream& stream);
+	// state is written to given file every given number of instructions, from a background thread
+	void UseCheckpoints(const string& fileName, uint64_t interval);
+	// processor halts after executing given number of instructions past initialization
+	void SetInstructionBudget(uint64_t instructions);
+	// value of r0 when program halted
+	inline uint8_t GetExitStatus() { return (uint8_t)processor.registerFile[0]; }
+	inline uint64_t GetInstructionCount() { return processor.instructionCount; }
+	inline bool BudgetExhausted() { return processor.budgetExhausted; }
+
 	void Start();
+	// runs reset routine and stops at initial pc, before event loop is started;
+	// Continue runs program from there
+	void Boot();
+	// runs booted or restored program until it halts, with event loop of its own;
+	// output is flushed, caches are not saved
+	void Continue();
+	// saves caches and flushes output once run ends
+	void Finish();
+	// starts from restored state instead of initializing processor, e.g. from a checkpoint
+	void StartFromSnapshot(const Snapshot& snapshot);
+	// continues from current state, e.g. after budget ran out or snapshot was restored;
+	// does nothing if program itself halted
+	void Resume();
+
+	// machine state at the instruction boundary where emulator stopped
+	void TakeSnapshot(Snapshot& snapshot);
+	void RestoreSnapshot(const Snapshot& snapshot);
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,46 @@
 #include "executable.h"
+#include "aot.h"
+#include "jit.h"
+#include "linker.h"
+
+Executable::Executable(const LinkerSections& sectionStartMap) : sectionStartMap(sectionStartMap),
+	symbolTable(make_shared<SymbolTable>()), sectionTable(make_shared<SectionTable>()), permissionTable(make_shared<PermissionTable>())
+{
+	memory = new uint8_t[MEMORY_ALLOCATION_SIZE]();
+	memset(permissionTable->pages, PERMISSION_WRITE | PERMISSION_EXECUTE, sizeof(permissionTable->pages));
+}
+
+Executable::Executable(const Executable& image) : initialPC(image.initialPC), initialPCDefined(image.initialPCDefined),
+	sectionStartMap(image.sectionStartMap), symbolTable(image.symbolTable), sectionTable(image.sectionTable),
+	sharedImage(image.sharedImage), permissionTable(image.permissionTable)
+{
+	memory = sharedImage ? sharedImage->Map() : 0;
+	mappedMemory = (memory != 0);
+	if (!mappedMemory)
+	{
+		memory = new uint8_t[MEMORY_ALLOCATION_SIZE];
+		memcpy(memory, image.memory, MEMORY_ALLOCATION_SIZE);
+	}
+}
+
+Executable::~Executable()
+{
+	if (mappedMemory)
+		SharedImage::Unmap(memory, MEMORY_ALLOCATION_SIZE);
+	else
+		delete[] memory;
+}
+
+void Executable::Share()
+{
+	if (sharedImage)
+		return;
+
+	// copies keep working without sharing if operating system refuses
+	shared_ptr<SharedImage> image = make_shared<SharedImage>();
+	if (image->Create(memory, MEMORY_ALLOCATION_SIZE))
+		sharedImage = image;
+}
 
 const uint8_t& Executable::MemoryRead(const uint16_t & address)
 {
@@ -15,35 +57,202 @@ void Executable::MemoryWrite(const uint16_t& address, const uint8_t& data, bool
 		return;
 	}
 	
+	if (!(Permissions(address) & PERMISSION_WRITE))
+		throw EmulatorException("Segmentation fault. Program tried to write to read-only section.", ErrorCodes::EMULATOR_SEGMENTATION_FAULT);
+
+	InvalidateDecoded(address);
+	memory[address] = data;
+}
+
+void Executable::CheckIfWritable(const uint16_t& address, const uint16_t& length)
+{
+	// device registers are never target of a transfer, their devices would not be notified
+	if ((uint32_t)address + length > MEMORY_MAPPED_REGISTERS_START)
+		throw EmulatorException("Segmentation fault. Transfer tried to write outside of memory.", ErrorCodes::EMULATOR_SEGMENTATION_FAULT);
+
+	// uniform pages are checked at once, mixed ones byte by byte
+	uint32_t end = (uint32_t)address + length;
+	for (uint32_t i = address; i < end;)
+	{
+		uint8_t permissions = permissionTable->pages[i / PERMISSION_PAGE_SIZE];
+		if (permissions & PERMISSION_MIXED)
+			permissions = permissionTable->bytes[i++];
+		else
+			i = (i / PERMISSION_PAGE_SIZE + 1) * PERMISSION_PAGE_SIZE;
+
+		if (!(permissions & PERMISSION_WRITE))
+			throw EmulatorException("Segmentation fault. Transfer tried to write to read-only section.", ErrorCodes::EMULATOR_SEGMENTATION_FAULT);
+	}
+}
+
+void Executable::MemoryCopy(const uint16_t& destination, const uint16_t& source, const uint16_t& length, const uint16_t& stride)
+{
+	uint32_t sourceEnd = length ? source + (uint32_t)(length - 1) * stride + 1 : source;
+	if (sourceEnd > MEMORY_ADDRESS_SPACE)
+		throw EmulatorException("Segmentation fault. Transfer tried to read outside of memory.", ErrorCodes::EMULATOR_SEGMENTATION_FAULT);
+	CheckIfWritable(destination, length);
+
+	// spans may overlap, guest copying inside one buffer expects memmove
+	if (stride == 1)
+		memmove(&memory[destination], &memory[source], length);
+	else
+	{
+		for (uint32_t i = 0; i < length; i++)
+			memory[destination + i] = memory[source + i * stride];
+	}
+
+	for (uint32_t i = 0; i < length; i++)
+		InvalidateDecoded(destination + i);
+}
+
+void Executable::MemoryFill(const uint16_t& destination, const uint8_t& data, const uint16_t& length)
+{
+	CheckIfWritable(destination, length);
+	memset(&memory[destination], data, length);
+
+	for (uint32_t i = 0; i < length; i++)
+		InvalidateDecoded(destination + i);
+}
+
+void Executable::MemoryLoad(const uint16_t& destination, const uint8_t* data, const uint16_t& length)
+{
+	CheckIfWritable(destination, length);
+	memcpy(&memory[destination], data, length);
+
+	for (uint32_t i = 0; i < length; i++)
+		InvalidateDecoded(destination + i);
+}
+
+void Executable::InvalidateDecoded(const uint16_t& address)
+{
+	// instructions are never decoded from memory mapped registers, so writes
+	// made there by device threads do not have to touch the cache
+	if (address >= MEMORY_MAPPED_REGISTERS_START)
+		return;
+
+	dirtyPages[address / DIRTY_PAGE_SIZE] = 1;
+	decodedCache.Invalidate(address);
+	if (jit)
+		jit->Invalidate(address);
+	if (aot)
+		aot->Invalidate(address);
+}
+
+uint64_t Executable::SaveMemory(uint8_t* image, bool track)
+{
+	memcpy(image, memory, MEMORY_ADDRESS_SPACE);
+	if (!track)
+		return 0;
+
+	memset(dirtyPages, 0, sizeof(dirtyPages));
+	dirtyGeneration = ++lastGeneration;
+
+	return dirtyGeneration;
+}
+
+void Executable::RestoreMemory(const uint8_t* image, uint64_t generation)
+{
+	bool all = (generation != dirtyGeneration);
+
+	for (uint32_t page = 0; page < MEMORY_ADDRESS_SPACE / DIRTY_PAGE_SIZE; page++)
+	{
+		uint32_t start = page * DIRTY_PAGE_SIZE;
+		if (!all && !dirtyPages[page] && start < MEMORY_MAPPED_REGISTERS_START)
+			continue;
+
+		// word compare is vectorized by compiler; unchanged words are left alone, so decoded
+		// and translated code survives and copy-on-write pages are not duplicated needlessly
+		const uint64_t* saved = (const uint64_t*)(image + start);
+		uint64_t* current = (uint64_t*)(memory + start);
+		for (uint32_t word = 0; word < DIRTY_PAGE_SIZE / sizeof(uint64_t); word++)
+		{
+			if (current[word] == saved[word])
+				continue;
+
+			for (uint32_t i = 0; i < sizeof(uint64_t); i++)
+				InvalidateDecoded((uint16_t)(start + word * sizeof(uint64_t) + i));
+			current[word] = saved[word];
+		}
+	}
+
+	memset(dirtyPages, 0, sizeof(dirtyPages));
+	dirtyGeneration = generation;
+}
+
+uint64_t Executable::ImageHash()
+{
+	uint64_t hash = 14695981039346656037ULL;
+	auto mix = [&hash](const uint8_t* data, size_t length)
+	{
+		for (size_t i = 0; i < length; i++)
+			hash = (hash ^ data[i]) * 1099511628211ULL;
+	};
+
+	mix(memory, MEMORY_MAPPED_REGISTERS_START);
+	mix((const uint8_t*)&initialPC, sizeof(initialPC));
+
 	LinkerSections::const_iterator it;
 	for (it = sectionStartMap.begin(); it != sectionStartMap.end(); it++)
 	{
-		const SectionTableEntry& entry = *sectionTable.GetEntryByName(it->first);
+		mix((const uint8_t*)it->first.c_str(), it->first.size() + 1);
+		mix((const uint8_t*)&it->second, sizeof(it->second));
 
-		if (((it->second <= address) && (address < it->second + entry.length)) &&
-			(((entry.flags & FLAG_WRITABLE) == 0) || ((entry.flags & FLAG_READ_ONLY) == 1)))
-			throw EmulatorException("Segmentation fault. Program tried to write to read-only section.", ErrorCodes::EMULATOR_SEGMENTATION_FAULT);
+		const SectionTableEntry* entry = sectionTable->GetEntryByName(it->first);
+		if (entry)
+		{
+			uint32_t length = (uint32_t)entry->length;
+			mix((const uint8_t*)&length, sizeof(length));
+			mix(&entry->flags, sizeof(entry->flags));
+		}
 	}
 
-	memory[address] = data;
+	return hash;
 }
 
-bool Executable::CheckIfExecutable(uint16_t initialPC, uint16_t length)
+void Executable::BuildPermissionTable()
 {
+	shared_ptr<PermissionTable> table = make_shared<PermissionTable>();
+	uint8_t* bytePermissions = table->bytes;
+	uint8_t* pagePermissions = table->pages;
+	memset(bytePermissions, PERMISSION_WRITE | PERMISSION_EXECUTE, sizeof(table->bytes));
+
 	LinkerSections::const_iterator it;
 	for (it = sectionStartMap.begin(); it != sectionStartMap.end(); it++)
 	{
-		if (sectionTable.GetEntryByName(it->first))
-		{
-			const SectionTableEntry& entry = *sectionTable.GetEntryByName(it->first);
+		const SectionTableEntry* entry = sectionTable->GetEntryByName(it->first);
+		if (!entry)
+			throw EmulatorException("Section '" + it->first + "' not found in provided files.", ErrorCodes::EMULATOR_SECTION_MISSING);
 
-			if (((it->second <= initialPC) && (initialPC + length < it->second + (uint16_t)entry.length)) &&
-				((entry.flags & FLAG_EXECUTABLE) == 0))
-				return false;
+		uint8_t permissions = 0;
+		if (entry->flags & FLAG_WRITABLE)
+			permissions |= PERMISSION_WRITE;
+		if (entry->flags & FLAG_EXECUTABLE)
+			permissions |= PERMISSION_EXECUTE;
+
+		for (uint32_t address = it->second; address < it->second + entry->length && address < MEMORY_ADDRESS_SPACE; address++)
+			bytePermissions[address] = permissions;
+	}
+
+	for (uint32_t page = 0; page < MEMORY_ADDRESS_SPACE / PERMISSION_PAGE_SIZE; page++)
+	{
+		const uint8_t* bytes = &bytePermissions[page * PERMISSION_PAGE_SIZE];
+
+		pagePermissions[page] = bytes[0];
+		for (uint32_t i = 1; i < PERMISSION_PAGE_SIZE; i++)
+		{
+			if (bytes[i] != bytes[0])
+			{
+				pagePermissions[page] = PERMISSION_MIXED;
+				break;
+			}
 		}
-		else
-			throw EmulatorException("Section '" + it->first + "' not found in provided files.", ErrorCodes::EMULATOR_SECTION_MISSING);
 	}
 
-	return true;
+	// copies made earlier keep the table they started with
+	permissionTable = table;
+}
+
+bool Executable::CheckIfExecutable(uint16_t initialPC, uint16_t length)
+{
+	return (Permissions(initialPC) & PERMISSION_EXECUTE) && (Permissions(initialPC + length - 1) & PERMISSION_EXECUTE);
 }
\ No newline at end of file
@@ -2,34 +2,119 @@
 #define _EXECUTABLE_LINKER_H
 
 #define MEMORY_ADDRESS_SPACE 65536
+// word access at the last address reads one byte past address space; memory is allocated
+// and mapped with a page more, so that byte always belongs to the same executable
+#define MEMORY_ALLOCATION_SIZE (MEMORY_ADDRESS_SPACE + 4096)
 
 #include "../common/structures.h"
+#include "decodecache.h"
+#include "sharedimage.h"
 #include <cstdint>
+#include <cstring>
+#include <memory>
+
+#define PERMISSION_PAGE_SIZE 256
+#define PERMISSION_WRITE	0x01
+#define PERMISSION_EXECUTE	0x02
+// page holds bytes with different permissions, they are looked up one by one
+#define PERMISSION_MIXED	0x80
+
+// granularity at which writes are tracked for restoring snapshots
+#define DIRTY_PAGE_SIZE 256
 
 typedef map<string, uint16_t> LinkerSections;
 
+struct PermissionTable
+{
+	uint8_t pages[MEMORY_ADDRESS_SPACE / PERMISSION_PAGE_SIZE];
+	uint8_t bytes[MEMORY_ADDRESS_SPACE];
+};
+
+class JITCompiler;
+class AOTRuntime;
+
 class Executable
 {
 
 private:
-	uint8_t memory[MEMORY_ADDRESS_SPACE];
+	uint8_t* memory;
+	// set if memory is a private view of shared image instead of being allocated
+	bool mappedMemory = false;
 	uint16_t initialPC;
 	bool initialPCDefined = false;
 
+	// tables and image are never changed once executable is copied, so copies share them
 	const LinkerSections sectionStartMap;
-	SymbolTable symbolTable;
-	SectionTable sectionTable;
+	shared_ptr<SymbolTable> symbolTable;
+	shared_ptr<SectionTable> sectionTable;
+	shared_ptr<SharedImage> sharedImage;
+
+	// permissions of memory not covered by any section are not restricted
+	shared_ptr<PermissionTable> permissionTable;
+
+	// pages of ordinary memory written since snapshot of given generation was taken or restored;
+	// memory mapped registers are written by device threads too, so their page is always restored
+	uint8_t dirtyPages[MEMORY_ADDRESS_SPACE / DIRTY_PAGE_SIZE] = {};
+	uint64_t dirtyGeneration = 0;
+	uint64_t lastGeneration = 0;
+
+	// must be called once sections are placed and their lengths are known
+	void BuildPermissionTable();
+	// throws if some byte of the span is read-only or memory mapped register
+	void CheckIfWritable(const uint16_t& address, const uint16_t& length);
+	inline uint8_t Permissions(const uint16_t& address)
+	{
+		uint8_t permissions = permissionTable->pages[address / PERMISSION_PAGE_SIZE];
+		return (permissions & PERMISSION_MIXED) ? permissionTable->bytes[address] : permissions;
+	}
+
+	DecodedInstructionCache decodedCache;
+	// set while translated code exists for this executable
+	JITCompiler* jit = 0;
+	// set while running ahead-of-time translated program
+	AOTRuntime* aot = 0;
 
 public:
-	Executable(const LinkerSections& sectionStartMap) : sectionStartMap(sectionStartMap) {}
+	Executable(const LinkerSections& sectionStartMap);
+	// copy of loaded image for another emulator instance; decoded and translated code is not copied,
+	// memory is mapped copy-on-write if image is shared
+	Executable(const Executable& image);
+	~Executable();
+
+	// later copies map memory from the operating system instead of copying it;
+	// memory of this executable must not change afterwards
+	void Share();
 	const uint8_t& MemoryRead(const uint16_t& address);
 	void MemoryWrite(const uint16_t& address, const uint8_t& data, bool linker = true);
+	// block transfers made by devices; whole destination span is checked before anything is written
+	void MemoryCopy(const uint16_t& destination, const uint16_t& source, const uint16_t& length, const uint16_t& stride = 1);
+	void MemoryFill(const uint16_t& destination, const uint8_t& data, const uint16_t& length);
+	void MemoryLoad(const uint16_t& destination, const uint8_t* data, const uint16_t& length);
 	
 	bool CheckIfExecutable(uint16_t initialPC, uint16_t length);
 
+	DecodedInstructionCache& GetDecodedCache() { return decodedCache; }
+	// every write of guest memory ends here, so it also marks written page dirty
+	void InvalidateDecoded(const uint16_t& address);
+
+	// copies whole memory and starts tracking writes against it, returns generation of the copy;
+	// untracked copy leaves tracking as it was and has generation 0
+	uint64_t SaveMemory(uint8_t* image, bool track = true);
+	// writes back only pages dirtied since image of given generation was saved or restored
+	// (all of them for any other image), skipping words that did not change
+	void RestoreMemory(const uint8_t* image, uint64_t generation);
+
+	// FNV-1a hash of loaded memory, section placement and entry point
+	uint64_t ImageHash();
+
 	uint16_t& InitialPC() { return initialPC; }
 	friend class Linker;
 	friend class Emulator;
+	friend class JITCompiler;
+	friend class AOTRuntime;
+	friend class Translator;
+	friend class Checkpoint;
+	friend class CPU;
 };
 
 #endif
\ No newline at end of file
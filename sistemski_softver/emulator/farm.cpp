@@ -0,0 +1,195 @@
+#include "farm.h"
+#include "threadpool.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+
+Farm::Farm(const string& manifestFile, ExecutionEngine engine) : engine(engine)
+{
+	LoadManifest(manifestFile);
+	LinkImages();
+}
+
+Farm::~Farm()
+{
+	map<string, Executable*>::iterator it;
+	for (it = images.begin(); it != images.end(); it++)
+		delete it->second;
+}
+
+void Farm::LoadManifest(const string& fileName)
+{
+	ifstream manifest(fileName);
+	if (!manifest.is_open())
+		throw EmulatorException("Cannot open farm manifest '" + fileName + "'.", ErrorCodes::IO_INPUT_EXCEPTION);
+
+	regex placeRegex("^-place=\\.{0,1}[a-zA-Z_][a-zA-Z0-9_]*@0x[0-9a-fA-F]{1,4}$");
+	regex inputRegex("^-input=.+$");
+	regex outputRegex("^-output=.+$");
+	regex budgetRegex("^-budget=[0-9]{1,18}$");
+	regex objectFileRegex("^[^-].*$");
+
+	string line;
+	for (unsigned long lineNumber = 1; getline(manifest, line); lineNumber++)
+	{
+		istringstream tokens(line);
+		FarmJob job;
+		// empty lines and comments
+		if (!(tokens >> job.name) || job.name[0] == '#')
+			continue;
+
+		string token;
+		while (tokens >> token)
+		{
+			if (regex_match(token, placeRegex))
+			{
+				string sectionName = token.substr(token.find('=') + 1, token.find('@') - token.find('=') - 1);
+				uint16_t location = (uint16_t)strtol(token.substr(token.find('@') + 1).c_str(), 0, 16);
+
+				job.sections.insert({ sectionName, location });
+			}
+			else if (regex_match(token, inputRegex))
+				job.inputFile = token.substr(token.find('=') + 1);
+			else if (regex_match(token, outputRegex))
+				job.outputFile = token.substr(token.find('=') + 1);
+			else if (regex_match(token, budgetRegex))
+				job.budget = strtoull(token.substr(token.find('=') + 1).c_str(), 0, 10);
+			else if (regex_match(token, objectFileRegex))
+				job.objectFiles.push_back(token);
+			else
+				throw EmulatorException("Farm manifest line " + to_string(lineNumber) + " has invalid parameter '" + token + "'.", ErrorCodes::EMULATOR_FARM_MANIFEST);
+		}
+
+		if (job.objectFiles.empty())
+			throw EmulatorException("Farm manifest line " + to_string(lineNumber) + " has no object files.", ErrorCodes::EMULATOR_FARM_MANIFEST);
+		if (job.outputFile.empty())
+			job.outputFile = job.name + ".out";
+
+		jobs.push_back(job);
+	}
+}
+
+void Farm::LinkImages()
+{
+	map<string, string> linkErrors;
+
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		FarmJob& job = jobs[i];
+
+		string key;
+		for (size_t j = 0; j < job.objectFiles.size(); j++)
+			key += job.objectFiles[j] + '\n';
+		LinkerSections::const_iterator it;
+		for (it = job.sections.begin(); it != job.sections.end(); it++)
+			key += it->first + '@' + to_string(it->second) + '\n';
+
+		if (images.find(key) == images.end())
+		{
+			images[key] = 0;
+			try
+			{
+				Linker linker(job.objectFiles, job.sections);
+				images[key] = linker.GetExecutable();
+				// jobs map it copy-on-write, only pages they write to are duplicated
+				images[key]->Share();
+			}
+			catch (const exception& ex)
+			{
+				linkErrors[key] = ex.what();
+			}
+		}
+
+		jobImages.push_back(images[key]);
+		if (!images[key])
+			job.error = linkErrors[key];
+	}
+}
+
+void Farm::RunJob(size_t index)
+{
+	FarmJob& job = jobs[index];
+	if (!jobImages[index])
+		return;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	try
+	{
+		// declared first, so buffered output is flushed into it when emulator is destroyed
+		ofstream output(job.outputFile, ios::binary);
+		if (!output.is_open())
+			throw EmulatorException("Cannot open output file '" + job.outputFile + "'.", ErrorCodes::IO_OUTPUT_EXCEPTION);
+
+		Emulator emulator(new Executable(*jobImages[index]), engine);
+		emulator.UseHeadlessMode();
+		emulator.UseOutput(output);
+		emulator.UseVirtualTimer(timerInstructionsPerMs);
+		if (!job.inputFile.empty())
+			emulator.UseInputFile(job.inputFile, inputRate);
+		emulator.SetInstructionBudget(job.budget);
+		emulator.Start();
+
+		job.exitStatus = emulator.GetExitStatus();
+		job.instructions = emulator.GetInstructionCount();
+		job.budgetExhausted = emulator.BudgetExhausted();
+	}
+	catch (const exception& ex)
+	{
+		job.error = ex.what();
+	}
+	job.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void Farm::Run(unsigned numberOfWorkers)
+{
+	WorkStealingPool pool(numberOfWorkers);
+	for (size_t i = 0; i < jobs.size(); i++)
+		pool.Submit([this, i] { RunJob(i); });
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	pool.Run();
+	milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+size_t Farm::FailedJobs()
+{
+	size_t failed = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+		if (!jobs[i].error.empty())
+			failed++;
+
+	return failed;
+}
+
+void Farm::PrintJob(ostream& out, const FarmJob& job)
+{
+	out << job.name << ' ';
+	if (!job.error.empty())
+	{
+		out << "failed " << job.error << endl;
+		return;
+	}
+
+	out << (job.budgetExhausted ? "budget" : "halted") << " exit=" << (int)job.exitStatus << " instructions=" << job.instructions
+		<< " time=" << fixed << setprecision(3) << job.milliseconds << "ms" << endl;
+}
+
+void Farm::PrintStatistics(ostream& out)
+{
+	uint64_t instructions = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const FarmJob& job = jobs[i];
+		instructions += job.instructions;
+
+		PrintJob(out, job);
+	}
+
+	out << "jobs=" << jobs.size() << " failed=" << FailedJobs() << " images=" << images.size() << " instructions=" << instructions
+		<< " time=" << fixed << setprecision(3) << milliseconds << "ms";
+	if (milliseconds > 0)
+		out << " mips=" << setprecision(1) << instructions / milliseconds / 1000;
+	out << endl;
+}
\ No newline at end of file
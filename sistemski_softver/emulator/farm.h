@@ -0,0 +1,74 @@
+#ifndef _FARM_EMULATOR_H
+#define _FARM_EMULATOR_H
+
+#include "emulator.h"
+#include "linker.h"
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// timer period unit of farm jobs when no -vtimer is given; real time timer
+// would need an event loop thread per job
+#define FARM_DEFAULT_INSTRUCTIONS_PER_MS 1000
+
+// one line of manifest:
+// <name> [-input=<file>] [-output=<file>] [-budget=<instructions>] <object files> -place=<section>@<address>...
+struct FarmJob
+{
+	string name;
+	vector<string> objectFiles;
+	LinkerSections sections;
+	string inputFile;
+	// <name>.out if not given
+	string outputFile;
+	// 0 for no limit
+	uint64_t budget = 0;
+
+	// filled in once job has run
+	string error;
+	uint8_t exitStatus = 0;
+	uint64_t instructions = 0;
+	bool budgetExhausted = false;
+	double milliseconds = 0;
+};
+
+// runs jobs of a manifest on a work-stealing pool, each on its own processor
+// and copy of the image; jobs sharing object files and placement are linked once
+class Farm
+{
+
+private:
+	vector<FarmJob> jobs;
+	// image each job starts from, keyed by object files and placement
+	map<string, Executable*> images;
+	vector<Executable*> jobImages;
+
+	ExecutionEngine engine;
+	uint32_t timerInstructionsPerMs = FARM_DEFAULT_INSTRUCTIONS_PER_MS;
+	uint32_t inputRate = 1000;
+	double milliseconds = 0;
+
+	void LoadManifest(const string& fileName);
+	void LinkImages();
+	void RunJob(size_t job);
+
+public:
+	Farm(const string& manifestFile, ExecutionEngine engine);
+	~Farm();
+
+	inline void UseVirtualTimer(uint32_t instructionsPerMs) { timerInstructionsPerMs = instructionsPerMs; }
+	inline void SetInputRate(uint32_t rate) { inputRate = rate; }
+
+	// 0 workers stands for one per hardware thread
+	void Run(unsigned numberOfWorkers);
+	// one line per job in manifest order, followed by totals
+	void PrintStatistics(ostream& out);
+	static void PrintJob(ostream& out, const FarmJob& job);
+	// number of jobs that ended with an error
+	size_t FailedJobs();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "forkserver.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+ForkServer::ForkServer(Emulator& emulator, bool useFork) : emulator(emulator), useFork(useFork)
+{
+#ifdef _WIN32
+	this->useFork = false;
+#endif
+
+	// job output goes to files, console is left to results
+	emulator.UseHeadlessMode();
+	emulator.Boot();
+
+	if (!this->useFork)
+	{
+		booted = new Snapshot();
+		emulator.TakeSnapshot(*booted);
+	}
+}
+
+ForkServer::~ForkServer()
+{
+	delete booted;
+}
+
+bool ForkServer::ParseJob(const string& line, FarmJob& job)
+{
+	static const regex inputRegex("^-input=.+$");
+	static const regex outputRegex("^-output=.+$");
+	static const regex budgetRegex("^-budget=[0-9]{1,18}$");
+
+	istringstream tokens(line);
+	// empty lines and comments
+	if (!(tokens >> job.name) || job.name[0] == '#')
+		return false;
+
+	string token;
+	while (tokens >> token)
+	{
+		if (regex_match(token, inputRegex))
+			job.inputFile = token.substr(token.find('=') + 1);
+		else if (regex_match(token, outputRegex))
+			job.outputFile = token.substr(token.find('=') + 1);
+		else if (regex_match(token, budgetRegex))
+			job.budget = strtoull(token.substr(token.find('=') + 1).c_str(), 0, 10);
+		else if (job.error.empty())
+			job.error = "Invalid job parameter '" + token + "'.";
+	}
+
+	// jobs themselves are read from standard input
+	if (job.inputFile == "-" && job.error.empty())
+		job.error = "Job input cannot be standard input.";
+	if (job.outputFile.empty())
+		job.outputFile = job.name + ".out";
+
+	return true;
+}
+
+void ForkServer::RunJob(FarmJob& job)
+{
+	try
+	{
+		// declared first, so it outlives terminal writing into it
+		ofstream output(job.outputFile, ios::binary);
+		if (!output.is_open())
+			throw EmulatorException("Cannot open output file '" + job.outputFile + "'.", ErrorCodes::IO_OUTPUT_EXCEPTION);
+
+		if (booted)
+			emulator.RestoreSnapshot(*booted);
+		if (!job.inputFile.empty())
+			emulator.UseInputFile(job.inputFile, inputRate);
+		else
+			emulator.CloseInputFile();
+		emulator.SetInstructionBudget(job.budget ? job.budget : budget);
+
+		emulator.UseOutput(output);
+		try
+		{
+			emulator.Continue();
+		}
+		catch (...)
+		{
+			emulator.UseOutput(cout);
+			throw;
+		}
+		emulator.UseOutput(cout);
+
+		job.exitStatus = emulator.GetExitStatus();
+		job.instructions = emulator.GetInstructionCount();
+		job.budgetExhausted = emulator.BudgetExhausted();
+	}
+	catch (const exception& ex)
+	{
+		job.error = ex.what();
+	}
+}
+
+void ForkServer::RunForked(FarmJob& job)
+{
+#ifndef _WIN32
+	// child sends its results back: exit status, budget exhausted, instructions, error text
+	int channel[2];
+	if (pipe(channel) != 0)
+	{
+		job.error = "Cannot create pipe for job process.";
+		return;
+	}
+
+	// otherwise whatever is buffered would be written by child as well
+	cout.flush();
+	pid_t child = fork();
+	if (child < 0)
+	{
+		close(channel[0]);
+		close(channel[1]);
+		job.error = "Cannot fork job process.";
+		return;
+	}
+
+	if (child == 0)
+	{
+		close(channel[0]);
+		RunJob(job);
+
+		string result;
+		result.push_back((char)job.exitStatus);
+		result.push_back((char)job.budgetExhausted);
+		result.append((const char*)&job.instructions, sizeof(job.instructions));
+		result.append(job.error);
+		for (size_t written = 0; written < result.size();)
+		{
+			ssize_t count = write(channel[1], result.data() + written, result.size() - written);
+			if (count <= 0)
+				break;
+			written += count;
+		}
+
+		// destructors belong to server process
+		_exit(0);
+	}
+
+	close(channel[1]);
+	string result;
+	char buffer[256];
+	ssize_t count;
+	while ((count = read(channel[0], buffer, sizeof(buffer))) > 0)
+		result.append(buffer, count);
+	close(channel[0]);
+
+	int status;
+	waitpid(child, &status, 0);
+
+	if (result.size() < 2 + sizeof(job.instructions))
+	{
+		job.error = "Job process ended abnormally.";
+		return;
+	}
+
+	job.exitStatus = (uint8_t)result[0];
+	job.budgetExhausted = result[1] != 0;
+	memcpy(&job.instructions, result.data() + 2, sizeof(job.instructions));
+	job.error = result.substr(2 + sizeof(job.instructions));
+#endif
+}
+
+void ForkServer::Serve(istream& jobs, ostream& results)
+{
+	string line;
+	while (getline(jobs, line))
+	{
+		FarmJob job;
+		if (!ParseJob(line, job))
+			continue;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		if (job.error.empty())
+		{
+			if (useFork)
+				RunForked(job);
+			else
+				RunJob(job);
+		}
+		job.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		if (!job.error.empty())
+			failedJobs++;
+		// endl flushes, so whoever feeds jobs can wait for each answer
+		Farm::PrintJob(results, job);
+	}
+}
\ No newline at end of file
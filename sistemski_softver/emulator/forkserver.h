@@ -0,0 +1,51 @@
+#ifndef _FORKSERVER_EMULATOR_H
+#define _FORKSERVER_EMULATOR_H
+
+#include "emulator.h"
+#include "farm.h"
+#include "snapshot.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+using namespace std;
+
+// one line of job stream, manifest line of farm without object files:
+// <name> [-input=<file>] [-output=<file>] [-budget=<instructions>]
+// every job is answered by the line farm prints for it, once the job has finished
+
+// boots program once and runs every job from the point where initialization
+// stopped, so jobs pay neither for linking nor for reset routine; on POSIX each
+// job runs in a forked process, elsewhere booted state is restored from a snapshot
+class ForkServer
+{
+
+private:
+	Emulator& emulator;
+	bool useFork;
+	// booted state, taken only when jobs are not forked
+	Snapshot* booted = 0;
+	uint64_t budget = 0;
+	uint32_t inputRate = 1000;
+	size_t failedJobs = 0;
+
+	bool ParseJob(const string& line, FarmJob& job);
+	void RunJob(FarmJob& job);
+	void RunForked(FarmJob& job);
+
+public:
+	// emulator has to be configured, but not started
+	ForkServer(Emulator& emulator, bool useFork);
+	~ForkServer();
+
+	inline void SetInputRate(uint32_t rate) { inputRate = rate; }
+	// used by jobs that do not give budget of their own
+	inline void SetInstructionBudget(uint64_t instructions) { budget = instructions; }
+
+	// runs jobs until end of stream
+	void Serve(istream& jobs, ostream& results);
+	// number of jobs that ended with an error
+	inline size_t FailedJobs() const { return failedJobs; }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "fusion.h"
+#include "cpu.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+void FusionTable::Load(const string& fileName)
+{
+	ifstream input(fileName);
+	if (!input)
+		throw EmulatorException("Fusion table '" + fileName + "' cannot be opened.", ErrorCodes::EMULATOR_INVALID_FUSION_TABLE);
+
+	string line;
+	while (getline(input, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		stringstream stream(line);
+		string first, second;
+		uint64_t count = 0;
+		stream >> first >> second >> count;
+
+		int firstCode = ISALookupMnemonic(first);
+		int secondCode = ISALookupMnemonic(second);
+		if (firstCode < 0 || secondCode < 0)
+			throw EmulatorException("Invalid pair '" + line + "' in fusion table '" + fileName + "'.", ErrorCodes::EMULATOR_INVALID_FUSION_TABLE);
+
+		fused[firstCode][secondCode] = true;
+		pairCount[firstCode][secondCode] = count;
+	}
+}
+
+void FusionTable::Save(const string& fileName)
+{
+	vector<pair<uint64_t, pair<int, int>>> pairs;
+	uint64_t total = 0;
+
+	for (int first = 0; first < FUSION_TABLE_SIZE; first++)
+	{
+		// these never fall through to the next instruction in memory
+		if (first == InstructionMnemonic::HALT || first == InstructionMnemonic::INT || first == InstructionMnemonic::JMP ||
+			first == InstructionMnemonic::CALL || first == InstructionMnemonic::RET || first == InstructionMnemonic::IRET)
+			continue;
+		// interrupt it waited for has to be taken before anything else runs
+		if (first == InstructionMnemonic::WAIT)
+			continue;
+
+		for (int second = 0; second < FUSION_TABLE_SIZE; second++)
+		{
+			if (pairCount[first][second] == 0)
+				continue;
+
+			pairs.push_back({ pairCount[first][second], { first, second } });
+			total += pairCount[first][second];
+		}
+	}
+
+	sort(pairs.rbegin(), pairs.rend());
+
+	ofstream output(fileName);
+	if (!output)
+		throw EmulatorException("Fusion table '" + fileName + "' cannot be written.", ErrorCodes::EMULATOR_INVALID_FUSION_TABLE);
+
+	output << "# first second count" << endl;
+
+	uint64_t covered = 0;
+	for (size_t i = 0; i < pairs.size() && i < FUSION_MAX_PAIRS && covered < FUSION_COVERAGE * total; i++)
+	{
+		output << isaTable[pairs[i].second.first].mnemonic << " " << isaTable[pairs[i].second.second].mnemonic << " " << pairs[i].first << endl;
+		covered += pairs[i].first;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef _FUSION_EMULATOR_H
+#define _FUSION_EMULATOR_H
+
+#include "../common/isa.h"
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// opcode field is 5 bits wide
+#define FUSION_TABLE_SIZE ISA_NUMBER_OF_CODES
+// training run keeps the most frequent pairs until they cover this share of all sequential pairs
+#define FUSION_COVERAGE 0.9
+#define FUSION_MAX_PAIRS 16
+
+// pairs of instructions that are executed as one superinstruction, i.e. without
+// interrupt and terminal check between them; training run only counts the pairs
+class FusionTable
+{
+
+private:
+	bool training;
+	uint64_t pairCount[FUSION_TABLE_SIZE][FUSION_TABLE_SIZE] = {};
+	bool fused[FUSION_TABLE_SIZE][FUSION_TABLE_SIZE] = {};
+
+public:
+	FusionTable(bool training) : training(training) {}
+
+	inline bool IsTraining() const { return training; }
+	inline bool IsFused(uint8_t first, uint8_t second) const { return fused[first % FUSION_TABLE_SIZE][second % FUSION_TABLE_SIZE]; }
+	inline void Record(uint8_t first, uint8_t second) { pairCount[first % FUSION_TABLE_SIZE][second % FUSION_TABLE_SIZE]++; }
+
+	// text file with one "first second count" line per fused pair, e.g. "cmp jne 1520"
+	void Load(const string& fileName);
+	void Save(const string& fileName);
+};
+
+#endif
\ No newline at end of file
@@ -1,5 +1,19 @@
 #include "interrupt.h"
+#include "cpu.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#define EVENT_LOOP_MAX_EVENTS 4
+#define KEYBOARD_BUFFER_SIZE 256
+
+#ifdef _WIN32
 void KeyboardHandler(CPU* processor)
 {
 	mutex& statusMutex = processor->GetEmulatorStatusMutex();
@@ -7,7 +21,6 @@ void KeyboardHandler(CPU* processor)
 	while (1)
 	{
 		statusMutex.lock();
-		// TODO: switch to pthreads once on linux to be able to cancel threads in ~CPU::CPU()
 		if (processor->GetHaltedStatus() && processor->GetInitializationFinished())
 		{
 			statusMutex.unlock();
@@ -17,56 +30,19 @@ void KeyboardHandler(CPU* processor)
 
 		// NOTE: getchar() return char and after than '\n (0x0a ascii)'
 		char input = getchar();
-		bool interruptRequested = false;
 
-		if (!processor->GetHaltedStatus() && input != '\n')
-		{
-			// memory mutex is in CPU class
-			processor->WriteIO(TERMINAL_DATA_IN, input);
-			interruptRequested = true;
-		}
-
-		if (interruptRequested)
-			processor->SetInterrupt(InterruptType::KEYBOARD);
+		if (!processor->GetHaltedStatus())
+			processor->GetTerminal().QueueKeyboard(*processor, &input, 1);
 	}
 }
 
 void TimerHandler(CPU* processor)
 {
-	uint16_t sleepTimeMs;
 	mutex& statusMutex = processor->GetEmulatorStatusMutex();
 		
 	while (1)
 	{
-		switch (processor->memory_read(TIMER_CFG))
-		{
-		case 0x0:
-			sleepTimeMs = 500;
-			break;
-		case 0x1:
-			sleepTimeMs = 1000;
-			break;
-		case 0x2:
-			sleepTimeMs = 1500;
-			break;
-		case 0x3:
-			sleepTimeMs = 2000;
-			break;
-		case 0x4:
-			sleepTimeMs = 5000;
-			break;
-		case 0x5:
-			sleepTimeMs = 10000;
-			break;
-		case 0x6:
-			sleepTimeMs = 30000;
-			break;
-		case 0x7:
-			sleepTimeMs = 60000;
-			break;
-		}
-
-		this_thread::sleep_for(chrono::milliseconds(sleepTimeMs));
+		this_thread::sleep_for(chrono::milliseconds(processor->GetTimer().PeriodMs()));
 
 		statusMutex.lock();
 		if (processor->GetHaltedStatus() && processor->GetInitializationFinished())
@@ -78,4 +54,158 @@ void TimerHandler(CPU* processor)
 
 		processor->SetInterrupt(InterruptType::TIMER);
 	}
+}
+
+void EventLoop::Start()
+{
+	if (keyboard)
+		keyboardThread = new thread(KeyboardHandler, &processor);
+	// virtual time timer is driven by executed instructions instead of a thread
+	if (!processor.GetTimer().IsVirtual())
+		timerThread = new thread(TimerHandler, &processor);
+}
+
+void EventLoop::Stop()
+{
+	if (timerThread)
+	{
+		timerThread->join();
+		delete timerThread;
+		timerThread = 0;
+	}
+	if (keyboardThread)
+	{
+		// console input cannot be waited for together with anything else here
+		cout << "Press ENTER key to end..." << endl;
+		keyboardThread->join();
+		delete keyboardThread;
+		keyboardThread = 0;
+	}
+}
+#else
+void EventLoop::Start()
+{
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	shutdownFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (epollFd < 0 || shutdownFd < 0)
+		throw EmulatorException("Cannot create event loop.", ErrorCodes::EMULATOR_EVENT_LOOP);
+
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = shutdownFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, shutdownFd, &event);
+
+	// regular files and /dev/null cannot be polled, such input is not delivered
+	stdinFlags = keyboard ? fcntl(STDIN_FILENO, F_GETFL) : -1;
+	event.data.fd = STDIN_FILENO;
+	if (stdinFlags >= 0 && epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &event) == 0)
+		fcntl(STDIN_FILENO, F_SETFL, stdinFlags | O_NONBLOCK);
+	else
+		stdinFlags = -1;
+
+	// virtual time timer is driven by executed instructions instead of the loop
+	if (!processor.GetTimer().IsVirtual())
+	{
+		timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+		if (timerFd < 0)
+			throw EmulatorException("Cannot create event loop.", ErrorCodes::EMULATOR_EVENT_LOOP);
+
+		event.data.fd = timerFd;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+		ArmTimer(processor.GetTimer().PeriodMs());
+	}
+
+	loopThread = new thread(&EventLoop::Loop, this);
+}
+
+void EventLoop::Stop()
+{
+	if (!loopThread)
+		return;
+
+	uint64_t one = 1;
+	if (write(shutdownFd, &one, sizeof(one)) < 0)
+		cout << "Cannot stop event loop." << endl;
+	loopThread->join();
+	delete loopThread;
+	loopThread = 0;
+}
+
+void EventLoop::ArmTimer(uint16_t periodMs)
+{
+	itimerspec period = {};
+	period.it_interval.tv_sec = periodMs / 1000;
+	period.it_interval.tv_nsec = (periodMs % 1000) * 1000000L;
+	period.it_value = period.it_interval;
+
+	timerfd_settime(timerFd, 0, &period, 0);
+	timerPeriodMs = periodMs;
+}
+
+bool EventLoop::ReadKeyboard()
+{
+	char input[KEYBOARD_BUFFER_SIZE];
+	ssize_t length = read(STDIN_FILENO, input, sizeof(input));
+	if (length < 0)
+		return errno == EAGAIN || errno == EINTR;
+	if (length == 0)
+		return false;
+
+	// one character at a time, each one would overwrite TERMINAL_DATA_IN before guest read the previous
+	processor.GetTerminal().QueueKeyboard(processor, input, length);
+	return true;
+}
+
+void EventLoop::Loop()
+{
+	epoll_event events[EVENT_LOOP_MAX_EVENTS];
+
+	while (1)
+	{
+		int ready = epoll_wait(epollFd, events, EVENT_LOOP_MAX_EVENTS, -1);
+		if (ready < 0 && errno == EINTR)
+			continue;
+		if (ready < 0)
+			return;
+
+		for (int i = 0; i < ready; i++)
+		{
+			int fd = events[i].data.fd;
+
+			if (fd == shutdownFd)
+				return;
+			else if (fd == STDIN_FILENO)
+			{
+				if (!ReadKeyboard())
+					epoll_ctl(epollFd, EPOLL_CTL_DEL, STDIN_FILENO, 0);
+			}
+			else if (fd == timerFd)
+			{
+				uint64_t expirations;
+				if (read(timerFd, &expirations, sizeof(expirations)) > 0)
+					processor.SetInterrupt(InterruptType::TIMER);
+
+				// new TIMER_CFG takes effect once current period expires
+				if (processor.GetTimer().PeriodMs() != timerPeriodMs)
+					ArmTimer(processor.GetTimer().PeriodMs());
+			}
+		}
+	}
+}
+#endif
+
+EventLoop::~EventLoop()
+{
+	Stop();
+
+#ifndef _WIN32
+	if (stdinFlags >= 0)
+		fcntl(STDIN_FILENO, F_SETFL, stdinFlags);
+	if (timerFd >= 0)
+		close(timerFd);
+	if (shutdownFd >= 0)
+		close(shutdownFd);
+	if (epollFd >= 0)
+		close(epollFd);
+#endif
 }
\ No newline at end of file
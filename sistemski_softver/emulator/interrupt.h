@@ -1,14 +1,48 @@
 #ifndef _INTERRUPT_EMULATOR_H
 #define _INTERRUPT_EMULATOR_H
 
-#include <mutex>
-#include "cpu.h"
+#include <cstdint>
+#include <thread>
 #include "../common/enums.h"
 using namespace std;
 
 class CPU;
 
-void KeyboardHandler(CPU* processor);
-void TimerHandler(CPU* processor);
+// delivers keyboard input and timer ticks to processor as interrupts; on linux
+// a single thread waits for stdin, timer and shutdown at once, so stopping the
+// loop never waits for a key to be pressed
+class EventLoop
+{
+
+private:
+	CPU& processor;
+	bool keyboard;
+
+#ifdef _WIN32
+	thread* keyboardThread = 0;
+	thread* timerThread = 0;
+#else
+	thread* loopThread = 0;
+	int epollFd = -1;
+	int timerFd = -1;
+	int shutdownFd = -1;
+	int stdinFlags = -1;
+	// period timer is currently armed with, 0 if it is not armed
+	uint16_t timerPeriodMs = 0;
+
+	void Loop();
+	void ArmTimer(uint16_t periodMs);
+	// false once stdin is closed
+	bool ReadKeyboard();
+#endif
+
+public:
+	EventLoop(CPU& processor, bool keyboard) : processor(processor), keyboard(keyboard) {}
+	~EventLoop();
+
+	void Start();
+	// returns once no more interrupts will be delivered
+	void Stop();
+};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "interruptcontroller.h"
+#include "cpu.h"
+
+uint8_t InterruptController::Allowed(const uint16_t& psw)
+{
+	uint8_t allowed = INTERRUPT_BIT(InterruptType::INT_INVALID_INSTRUCTION);
+	if (psw & FLAG_I)
+	{
+		if (psw & FLAG_Tl)
+			allowed |= INTERRUPT_BIT(InterruptType::KEYBOARD);
+		if (psw & FLAG_Tr)
+			allowed |= INTERRUPT_BIT(InterruptType::TIMER);
+		// DMA and storage completion have no mask bit of their own, guest asks for them per command
+		allowed |= INTERRUPT_BIT(InterruptType::DMA) | INTERRUPT_BIT(InterruptType::STORAGE);
+	}
+
+	return allowed;
+}
+
+int InterruptController::Acknowledge(const uint16_t& psw)
+{
+	// INT_INVALID_INSTRUCTION is non-maskable and is raised by the instruction
+	// being executed, so it has to be served before any device request
+	static const InterruptType priority[] = { InterruptType::INT_INVALID_INSTRUCTION, InterruptType::KEYBOARD, InterruptType::TIMER, InterruptType::DMA, InterruptType::STORAGE };
+
+	uint8_t requests = pending.load(memory_order_acquire) & Allowed(psw);
+	if (requests == 0)
+		return -1;
+
+	for (InterruptType type : priority)
+	{
+		if (requests & INTERRUPT_BIT(type))
+		{
+			pending.fetch_and((uint8_t)~INTERRUPT_BIT(type), memory_order_acquire);
+			return type;
+		}
+	}
+
+	return -1;
+}
+
+bool InterruptController::Deliverable(const uint16_t& psw) const
+{
+	return (pending.load(memory_order_acquire) & Allowed(psw)) != 0;
+}
+
+void InterruptController::WakeUp()
+{
+	lock_guard<mutex> lock(sleepMutex);
+	wakeUp.notify_all();
+}
+
+void InterruptController::WaitForRequest(const uint16_t& psw)
+{
+	unique_lock<mutex> lock(sleepMutex);
+	sleepers.fetch_add(1, memory_order_seq_cst);
+	wakeUp.wait(lock, [this, &psw] { return Deliverable(psw); });
+	sleepers.fetch_sub(1, memory_order_seq_cst);
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef _INTERRUPTCONTROLLER_EMULATOR_H
+#define _INTERRUPTCONTROLLER_EMULATOR_H
+
+#include "../common/enums.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+using namespace std;
+
+#define INTERRUPT_BIT(type) ((uint8_t)(1 << (type)))
+
+// pending interrupt requests, one bit per InterruptType; device threads only
+// set bits, so no lock is needed between them and the processor
+class InterruptController
+{
+
+private:
+	atomic<uint8_t> pending{ 0 };
+
+	// processor sleeping in WaitForRequest, only then devices take the mutex
+	atomic<int> sleepers{ 0 };
+	mutex sleepMutex;
+	condition_variable wakeUp;
+
+	static uint8_t Allowed(const uint16_t& psw);
+	void WakeUp();
+
+public:
+	// release makes everything device wrote before the request (e.g. TERMINAL_DATA_IN)
+	// visible to processor once it acknowledges the interrupt; sequentially consistent
+	// together with the sleepers check, so a sleeping processor is never missed
+	inline void Request(const InterruptType& type)
+	{
+		pending.fetch_or(INTERRUPT_BIT(type), memory_order_seq_cst);
+		if (sleepers.load(memory_order_seq_cst) != 0)
+			WakeUp();
+	}
+	// one relaxed load, checked by processor at the end of every batch
+	inline bool AnyPending() const { return pending.load(memory_order_relaxed) != 0; }
+	inline bool IsPending(const InterruptType& type) const { return (pending.load(memory_order_relaxed) & INTERRUPT_BIT(type)) != 0; }
+
+	// clears and returns highest priority request psw does not mask, -1 if there is none;
+	// masked requests stay pending until psw allows them
+	int Acknowledge(const uint16_t& psw);
+	// true if some pending request is not masked by psw
+	bool Deliverable(const uint16_t& psw) const;
+	// blocks calling thread until a request psw does not mask is pending
+	void WaitForRequest(const uint16_t& psw);
+	inline void Clear() { pending.store(0, memory_order_relaxed); }
+
+	// for snapshots
+	inline uint8_t Pending() const { return pending.load(memory_order_acquire); }
+	inline void Restore(uint8_t requests) { pending.store(requests, memory_order_release); }
+};
+
+#endif
\ No newline at end of file
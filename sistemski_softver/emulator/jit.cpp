@@ -0,0 +1,719 @@
+#include "jit.h"
+#include "codebuffer.h"
+#include <cstddef>
+#include <cstring>
+
+enum HostRegister
+{
+	RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// extensions of group 1 (0x81), group 2 (0xC1, 0xD3) and group 3 (0xF7) opcodes
+enum HostOperation
+{
+	HOST_ADD = 0,
+	HOST_OR = 1,
+	HOST_AND = 4,
+	HOST_SUB = 5,
+	HOST_XOR = 6,
+	HOST_CMP = 7,
+
+	HOST_SHL = 4,
+	HOST_SHR = 5,
+
+	HOST_TEST = 0,
+	HOST_NOT = 2
+};
+
+// opcodes of "operation r/m32, r32" form
+#define OPCODE_ADD 0x01
+#define OPCODE_OR  0x09
+#define OPCODE_SBB 0x19
+#define OPCODE_AND 0x21
+#define OPCODE_SUB 0x29
+#define OPCODE_XOR 0x31
+#define OPCODE_CMP 0x39
+#define OPCODE_MOV 0x89
+
+#define CONDITION_Z  0x04
+#define CONDITION_NZ 0x05
+
+// guest r0-r6 live in host registers while translated block runs; r7 (pc) is known at translation time
+static const int guestRegisters[PC_REGISTER] = { R8, R9, R10, R11, RBX, RBP, R12 };
+#define HOST_PSW R13
+#define HOST_CONTEXT R14
+#define HOST_MEMORY R15
+
+// rsi and rdi are used as temporaries, but Windows x64 calling convention wants them preserved
+static const int savedRegisters[] = { RBX, RBP, R12, R13, R14, R15, RSI, RDI };
+#define NUMBER_OF_SAVED_REGISTERS (sizeof(savedRegisters) / sizeof(savedRegisters[0]))
+
+#ifdef _WIN32
+#define HOST_ARGUMENT RCX
+#else
+#define HOST_ARGUMENT RDI
+#endif
+
+// minimal x86-64 encoder; all arithmetic is done on 32 bit registers holding zero extended 16 bit values
+class X86Emitter
+{
+
+private:
+	uint8_t* code;
+	size_t size = 0;
+
+	void Rex(bool wide, int reg, int index, int base)
+	{
+		uint8_t rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+		if (rex != 0x40)
+			Byte(rex);
+	}
+	void ModRM(int reg, int rm) { Byte(0xC0 | ((reg & 7) << 3) | (rm & 7)); }
+	// [base + disp32]
+	void ModRMDisplacement(int reg, int base, int32_t displacement)
+	{
+		Byte(0x80 | ((reg & 7) << 3) | (base & 7));
+		if ((base & 7) == RSP)
+			Byte(0x24);
+		Dword(displacement);
+	}
+	// [base + index * 2^scale]; base must not be rbp or r13
+	void ModRMIndexed(int reg, int base, int index, int scale)
+	{
+		Byte(0x04 | ((reg & 7) << 3));
+		Byte((scale << 6) | ((index & 7) << 3) | (base & 7));
+	}
+
+public:
+	X86Emitter(uint8_t* code) : code(code) {}
+
+	inline size_t Size() { return size; }
+
+	void Byte(uint8_t data) { code[size++] = data; }
+	void Dword(uint32_t data) { for (int i = 0; i < 4; i++) Byte((data >> (8 * i)) & 0xFF); }
+	void Qword(uint64_t data) { for (int i = 0; i < 8; i++) Byte((data >> (8 * i)) & 0xFF); }
+
+	void Operation(uint8_t opcode, int dst, int src) { Rex(false, src, 0, dst); Byte(opcode); ModRM(src, dst); }
+	void OperationImmediate(HostOperation operation, int dst, uint32_t immediate) { Rex(false, 0, 0, dst); Byte(0x81); ModRM(operation, dst); Dword(immediate); }
+	void Mov(int dst, int src) { Operation(OPCODE_MOV, dst, src); }
+	void Mov64(int dst, int src) { Rex(true, src, 0, dst); Byte(OPCODE_MOV); ModRM(src, dst); }
+	void MovImmediate(int dst, uint32_t immediate) { Rex(false, 0, 0, dst); Byte(0xB8 + (dst & 7)); Dword(immediate); }
+	void MovImmediate64(int dst, uint64_t immediate) { Rex(true, 0, 0, dst); Byte(0xB8 + (dst & 7)); Qword(immediate); }
+	void Movzx16(int dst, int src) { Rex(false, dst, 0, src); Byte(0x0F); Byte(0xB7); ModRM(dst, src); }
+	void Imul(int dst, int src) { Rex(false, dst, 0, src); Byte(0x0F); Byte(0xAF); ModRM(dst, src); }
+	void Not(int dst) { Rex(false, 0, 0, dst); Byte(0xF7); ModRM(HOST_NOT, dst); }
+	void TestImmediate(int dst, uint32_t immediate) { Rex(false, 0, 0, dst); Byte(0xF7); ModRM(HOST_TEST, dst); Dword(immediate); }
+	void ShiftImmediate(HostOperation operation, int dst, uint8_t count) { Rex(false, 0, 0, dst); Byte(0xC1); ModRM(operation, dst); Byte(count); }
+	void ShiftCl(HostOperation operation, int dst) { Rex(false, 0, 0, dst); Byte(0xD3); ModRM(operation, dst); }
+
+	void Load16(int dst, int base, int32_t displacement) { Rex(false, dst, 0, base); Byte(0x0F); Byte(0xB7); ModRMDisplacement(dst, base, displacement); }
+	void Load16Indexed(int dst, int base, int index, int scale) { Rex(false, dst, index, base); Byte(0x0F); Byte(0xB7); ModRMIndexed(dst, base, index, scale); }
+	void Load64(int dst, int base, int32_t displacement) { Rex(true, dst, 0, base); Byte(0x8B); ModRMDisplacement(dst, base, displacement); }
+	void Store16(int base, int32_t displacement, int src) { Byte(0x66); Rex(false, src, 0, base); Byte(OPCODE_MOV); ModRMDisplacement(src, base, displacement); }
+
+	void Push(int reg) { Rex(false, 0, 0, reg); Byte(0x50 + (reg & 7)); }
+	void Pop(int reg) { Rex(false, 0, 0, reg); Byte(0x58 + (reg & 7)); }
+	void Ret() { Byte(0xC3); }
+
+	// conditional jump with displacement patched later; returns position of displacement
+	size_t JumpIf(uint8_t condition) { Byte(0x0F); Byte(0x80 | condition); Dword(0); return size - 4; }
+	void PatchJump(size_t position)
+	{
+		int32_t displacement = (int32_t)(size - (position + 4));
+		memcpy(code + position, &displacement, sizeof(displacement));
+	}
+};
+
+JITCompiler::JITCompiler(CPU& processor, Executable* executable) : processor(processor), executable(executable)
+{
+	context.registerFile = processor.registerFile;
+	context.psw = &processor.psw;
+	context.memory = executable->memory;
+
+	// O and C depend only on signs of source, destination and result, so
+	// tables are filled by the interpreter's own flag logic
+	for (int i = 0; i < 8; i++)
+	{
+		int16_t src = (i & 4) ? -1 : 1;
+		int16_t dst = (i & 2) ? -1 : 1;
+		int16_t r = (i & 1) ? -1 : 1;
+
+		flagTables[JIT_FLAGS_ADD][i] = processor.ArithmeticFlags(src, dst, r, InstructionMnemonic::ADD);
+		flagTables[JIT_FLAGS_SUB][i] = processor.ArithmeticFlags(src, dst, r, InstructionMnemonic::SUB);
+		flagTables[JIT_FLAGS_CMP][i] = processor.ArithmeticFlags(src, dst, r, InstructionMnemonic::CMP);
+	}
+
+#if JIT_SUPPORTED
+	codeBuffer = AllocateCodeBuffer(JIT_CODE_BUFFER_SIZE);
+#endif
+}
+
+JITCompiler::~JITCompiler()
+{
+	Flush();
+	FreeCodeBuffer(codeBuffer, JIT_CODE_BUFFER_SIZE);
+}
+
+void JITCompiler::Run()
+{
+	while (!processor.halted)
+	{
+		uint16_t pc = processor.pc;
+		TranslatedBlock* block = blocks[pc];
+
+		if (!block && executionCount[pc] < JIT_HOT_THRESHOLD && ++executionCount[pc] == JIT_HOT_THRESHOLD)
+			block = Translate(pc);
+
+		// pending invalid instruction interrupt changes how the next instruction behaves, leave it to interpreter;
+		// so is a block some deadline falls into, interpreter reaches it after the right instruction
+		if (block && !processor.interrupts.IsPending(InterruptType::INT_INVALID_INSTRUCTION) &&
+			processor.instructionCount + block->numberOfInstructions <= processor.deviceDeadline)
+		{
+			// translated code keeps psw in a host register and leaves nothing deferred
+			processor.EvaluateFlags();
+			block->code(&context);
+			processor.instructionCount += block->numberOfInstructions;
+			processor.InstructionHandleInterrupt();
+			continue;
+		}
+
+		processor.InstructionFetchAndDecode();
+		processor.InstructionExecuteSpecialized();
+		processor.InstructionHandleInterrupt();
+	}
+}
+
+void JITCompiler::Invalidate(const uint16_t& address)
+{
+	if (pageBlocks[address / JIT_PAGE_SIZE] == 0)
+		return;
+
+	for (size_t i = 0; i < translatedBlocks.size();)
+	{
+		TranslatedBlock* block = translatedBlocks[i];
+		if (block->startPC <= address && address < block->endPC)
+		{
+			RemoveBlock(block);
+			translatedBlocks[i] = translatedBlocks.back();
+			translatedBlocks.pop_back();
+		}
+		else
+			i++;
+	}
+}
+
+void JITCompiler::Preload(uint16_t pc)
+{
+	if (blocks[pc] || executionCount[pc] >= JIT_HOT_THRESHOLD)
+		return;
+
+	executionCount[pc] = JIT_HOT_THRESHOLD;
+	Translate(pc);
+}
+
+void JITCompiler::GetBlockStarts(vector<uint16_t>& starts)
+{
+	for (size_t i = 0; i < translatedBlocks.size(); i++)
+		starts.push_back(translatedBlocks[i]->startPC);
+}
+
+void JITCompiler::RemoveBlock(TranslatedBlock* block)
+{
+	blocks[block->startPC] = 0;
+	// block has to become hot again before it is translated from new contents
+	executionCount[block->startPC] = 0;
+
+	for (uint32_t page = block->startPC / JIT_PAGE_SIZE; page <= (block->endPC - 1) / JIT_PAGE_SIZE; page++)
+		pageBlocks[page]--;
+
+	// host code is reclaimed only when whole buffer is flushed
+	delete block;
+}
+
+void JITCompiler::Flush()
+{
+	for (size_t i = 0; i < translatedBlocks.size(); i++)
+		RemoveBlock(translatedBlocks[i]);
+
+	translatedBlocks.clear();
+	codeSize = 0;
+}
+
+bool JITCompiler::Decode(const uint8_t* memory, uint16_t pc, JITInstruction& instruction)
+{
+	uint32_t address = pc;
+
+	uint8_t IP = memory[address++];
+	instruction.code = ((IP >> 3) & 0x1F);
+	instruction.operandSize = static_cast<OperandSize>((IP & 0x04) >> 2);
+	if (instruction.code < InstructionMnemonic::HALT || instruction.code > InstructionMnemonic::WAIT)
+		return false;
+
+	instruction.numberOfOperands = isaTable[instruction.code].numberOfOperands;
+	for (int i = 0; i < instruction.numberOfOperands; i++)
+	{
+		if (address >= MEMORY_MAPPED_REGISTERS_START)
+			return false;
+
+		uint8_t rawData = memory[address++];
+		instruction.addressingType[i] = static_cast<AddressingType>(rawData >> 5);
+		instruction.registerSelector[i] = ((rawData >> 1) & 0x0F);
+		instruction.byteSelector[i] = ByteSelector::NOT_APPLICABLE;
+		instruction.operand[i] = 0;
+
+		switch (instruction.addressingType[i])
+		{
+		case AddressingType::IMMEDIATELY:
+			instruction.operand[i] = memory[address++];
+			if (instruction.operandSize == OperandSize::WORD)
+				instruction.operand[i] |= memory[address++] << 8;
+			break;
+		case AddressingType::REGISTER_DIRECT:
+			if (instruction.operandSize == OperandSize::BYTE)
+				instruction.byteSelector[i] = static_cast<ByteSelector>(rawData & 0x01);
+			break;
+		case AddressingType::REGISTER_INDIRECT_NO_OFFSET:
+			break;
+		case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
+			instruction.operand[i] = memory[address++];
+			break;
+		case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
+		case AddressingType::MEMORY_DIRECT:
+			instruction.operand[i] = memory[address++];
+			instruction.operand[i] |= memory[address++] << 8;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	// code is never fetched from memory mapped registers
+	if (address > MEMORY_MAPPED_REGISTERS_START)
+		return false;
+
+	instruction.length = address - pc;
+	return true;
+}
+
+bool JITCompiler::IsBranch(const JITInstruction& instruction)
+{
+	switch (instruction.code)
+	{
+	case InstructionMnemonic::JMP:
+	case InstructionMnemonic::JEQ:
+	case InstructionMnemonic::JNE:
+	case InstructionMnemonic::JGT:
+		return true;
+	}
+
+	return false;
+}
+
+bool JITCompiler::IsIdleLoop(const uint8_t* memory, const JITInstruction& instruction, uint16_t pc)
+{
+	if (!IsBranch(instruction) || !CanTranslate(instruction, pc))
+		return false;
+
+	// same target JumpTarget computes
+	uint16_t target = instruction.operand[0];
+	if (instruction.addressingType[0] == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET && instruction.registerSelector[0] == PC_REGISTER)
+		target += pc + instruction.length;
+
+	return target <= pc && pc - target <= IDLE_LOOP_MAX_LENGTH && IsIdleLoopBody(memory, target, pc);
+}
+
+bool JITCompiler::IsIdleLoopBody(const uint8_t* memory, uint16_t start, uint16_t end)
+{
+	// such moves write the same values into the same registers on every pass and touch no memory
+	uint32_t pc = start;
+	JITInstruction instruction;
+	while (pc < end)
+	{
+		// interpreter checks every short backward branch, so other instructions are told apart before decoding
+		if ((memory[pc] >> 3) != InstructionMnemonic::MOV)
+			return false;
+
+		if (!Decode(memory, (uint16_t)pc, instruction) ||
+			instruction.addressingType[0] != AddressingType::REGISTER_DIRECT || instruction.registerSelector[0] >= PC_REGISTER ||
+			instruction.addressingType[1] != AddressingType::IMMEDIATELY)
+			return false;
+
+		pc += instruction.length;
+	}
+
+	return pc == end;
+}
+
+bool JITCompiler::CanTranslate(const JITInstruction& instruction, uint16_t pc)
+{
+	// stores, stack operations, interrupts and halt stay in interpreter, so translated
+	// code never writes guest memory and never has to notify devices
+	if (IsBranch(instruction))
+	{
+		// jumps through registers use stale operand, only targets known at translation time are translated
+		switch (instruction.addressingType[0])
+		{
+		case AddressingType::IMMEDIATELY:
+		case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
+		case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
+		case AddressingType::MEMORY_DIRECT:
+			return true;
+		}
+		return false;
+	}
+
+	switch (instruction.code)
+	{
+	case InstructionMnemonic::XCHG:
+	case InstructionMnemonic::MOV:
+	case InstructionMnemonic::ADD:
+	case InstructionMnemonic::SUB:
+	case InstructionMnemonic::MUL:
+	case InstructionMnemonic::CMP:
+	case InstructionMnemonic::NOT:
+	case InstructionMnemonic::AND:
+	case InstructionMnemonic::OR:
+	case InstructionMnemonic::XOR:
+	case InstructionMnemonic::TEST:
+	case InstructionMnemonic::SHL:
+	case InstructionMnemonic::SHR:
+		break;
+	default:
+		return false;
+	}
+
+	if (instruction.operandSize != OperandSize::WORD)
+		return false;
+
+	if (instruction.addressingType[0] != AddressingType::REGISTER_DIRECT || instruction.registerSelector[0] >= PC_REGISTER)
+		return false;
+
+	if (instruction.numberOfOperands == 1)
+		return true;
+
+	if (instruction.code == InstructionMnemonic::XCHG)
+		return instruction.addressingType[1] == AddressingType::REGISTER_DIRECT && instruction.registerSelector[1] < PC_REGISTER;
+
+	// devices may fill their registers only when they are read through device bus, which
+	// translated code bypasses, so sources known to be registers are left to interpreter
+	uint16_t operand = instruction.operand[1];
+	switch (instruction.addressingType[1])
+	{
+	case AddressingType::IMMEDIATELY:
+	case AddressingType::REGISTER_DIRECT:
+		break;
+	case AddressingType::MEMORY_DIRECT:
+		return operand < MEMORY_MAPPED_REGISTERS_START;
+	default:
+		if (instruction.registerSelector[1] == PC_REGISTER)
+		{
+			int16_t offset = 0;
+			if (instruction.addressingType[1] == AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET)
+				offset = (int8_t)(operand & 0xFF);
+			else if (instruction.addressingType[1] == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET)
+				offset = (int16_t)operand;
+
+			return (uint16_t)(pc + instruction.length + offset) < MEMORY_MAPPED_REGISTERS_START;
+		}
+		break;
+	}
+
+	// source is read only, so any other addressing type works as long as it does not use r8-r15
+	return instruction.registerSelector[1] <= PC_REGISTER;
+}
+
+void JITCompiler::EmitPrologue(X86Emitter& emitter)
+{
+	for (size_t i = 0; i < NUMBER_OF_SAVED_REGISTERS; i++)
+		emitter.Push(savedRegisters[i]);
+
+	emitter.Mov64(HOST_CONTEXT, HOST_ARGUMENT);
+
+	emitter.Load64(RDX, HOST_CONTEXT, offsetof(JITContext, registerFile));
+	for (int i = 0; i < PC_REGISTER; i++)
+		emitter.Load16(guestRegisters[i], RDX, 2 * i);
+
+	emitter.Load64(RDX, HOST_CONTEXT, offsetof(JITContext, psw));
+	emitter.Load16(HOST_PSW, RDX, 0);
+
+	emitter.Load64(HOST_MEMORY, HOST_CONTEXT, offsetof(JITContext, memory));
+}
+
+void JITCompiler::EmitExit(X86Emitter& emitter, uint16_t pc)
+{
+	emitter.Load64(RDX, HOST_CONTEXT, offsetof(JITContext, registerFile));
+	for (int i = 0; i < PC_REGISTER; i++)
+		emitter.Store16(RDX, 2 * i, guestRegisters[i]);
+
+	emitter.MovImmediate(RAX, pc);
+	emitter.Store16(RDX, 2 * PC_REGISTER, RAX);
+
+	emitter.Load64(RDX, HOST_CONTEXT, offsetof(JITContext, psw));
+	emitter.Store16(RDX, 0, HOST_PSW);
+
+	for (size_t i = NUMBER_OF_SAVED_REGISTERS; i > 0; i--)
+		emitter.Pop(savedRegisters[i - 1]);
+
+	emitter.Ret();
+}
+
+void JITCompiler::EmitSource(X86Emitter& emitter, const JITInstruction& instruction, uint16_t nextPC)
+{
+	// loads second operand into ecx, rax is used for address calculation
+	uint8_t registerSelector = instruction.registerSelector[1];
+	uint16_t operand = instruction.operand[1];
+
+	switch (instruction.addressingType[1])
+	{
+	case AddressingType::IMMEDIATELY:
+		emitter.MovImmediate(RCX, operand);
+		return;
+	case AddressingType::REGISTER_DIRECT:
+		if (registerSelector == PC_REGISTER)
+			emitter.MovImmediate(RCX, nextPC);
+		else
+			emitter.Mov(RCX, guestRegisters[registerSelector]);
+		return;
+	case AddressingType::MEMORY_DIRECT:
+		emitter.MovImmediate(RAX, operand);
+		break;
+	default:
+	{
+		int16_t offset = 0;
+		if (instruction.addressingType[1] == AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET)
+			offset = (int8_t)(operand & 0xFF);
+		else if (instruction.addressingType[1] == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET)
+			offset = (int16_t)operand;
+
+		if (registerSelector == PC_REGISTER)
+			emitter.MovImmediate(RAX, (uint16_t)(nextPC + offset));
+		else
+		{
+			emitter.Mov(RAX, guestRegisters[registerSelector]);
+			if (offset != 0)
+			{
+				emitter.OperationImmediate(HOST_ADD, RAX, (uint32_t)(int32_t)offset);
+				emitter.Movzx16(RAX, RAX);
+			}
+		}
+		break;
+	}
+	}
+
+	emitter.Load16Indexed(RCX, HOST_MEMORY, RAX, 0);
+}
+
+void JITCompiler::EmitFlagsZN(X86Emitter& emitter, int result)
+{
+	// result register holds zero extended 16 bit value
+	emitter.OperationImmediate(HOST_AND, HOST_PSW, (uint16_t)~(FLAG_Z | FLAG_N));
+
+	// N is bit 15 of the result moved to bit 3
+	emitter.Mov(RSI, result);
+	emitter.ShiftImmediate(HOST_SHR, RSI, 12);
+	emitter.OperationImmediate(HOST_AND, RSI, FLAG_N);
+	emitter.Operation(OPCODE_OR, HOST_PSW, RSI);
+
+	// carry is set by (result < 1) only when result is zero
+	emitter.OperationImmediate(HOST_CMP, result, 1);
+	emitter.Operation(OPCODE_SBB, RSI, RSI);
+	emitter.OperationImmediate(HOST_AND, RSI, FLAG_Z);
+	emitter.Operation(OPCODE_OR, HOST_PSW, RSI);
+}
+
+void JITCompiler::EmitFlagsOC(X86Emitter& emitter, JITFlagTable table)
+{
+	// source in ecx, destination in eax, result in edx; index = sign(src) << 2 | sign(dst) << 1 | sign(r)
+	emitter.Mov(RSI, RCX);
+	emitter.ShiftImmediate(HOST_SHR, RSI, 13);
+	emitter.OperationImmediate(HOST_AND, RSI, 4);
+
+	emitter.Mov(RDI, RAX);
+	emitter.ShiftImmediate(HOST_SHR, RDI, 14);
+	emitter.OperationImmediate(HOST_AND, RDI, 2);
+	emitter.Operation(OPCODE_OR, RSI, RDI);
+
+	emitter.Mov(RDI, RDX);
+	emitter.ShiftImmediate(HOST_SHR, RDI, 15);
+	emitter.OperationImmediate(HOST_AND, RDI, 1);
+	emitter.Operation(OPCODE_OR, RSI, RDI);
+
+	emitter.MovImmediate64(RDI, (uint64_t)(uintptr_t)flagTables[table]);
+	emitter.Load16Indexed(RSI, RDI, RSI, 1);
+
+	// CMP leaves O unchanged, same as SetFlagO does
+	uint16_t mask = (table == JIT_FLAGS_CMP ? FLAG_C : FLAG_O | FLAG_C);
+	emitter.OperationImmediate(HOST_AND, HOST_PSW, (uint16_t)~mask);
+	emitter.Operation(OPCODE_OR, HOST_PSW, RSI);
+}
+
+void JITCompiler::EmitInstruction(X86Emitter& emitter, const JITInstruction& instruction, uint16_t nextPC)
+{
+	int dst = guestRegisters[instruction.registerSelector[0]];
+
+	if (instruction.numberOfOperands == 2 && instruction.code != InstructionMnemonic::XCHG)
+		EmitSource(emitter, instruction, nextPC);
+
+	switch (instruction.code)
+	{
+	case InstructionMnemonic::XCHG:
+	{
+		int src = guestRegisters[instruction.registerSelector[1]];
+		emitter.Mov(RAX, dst);
+		emitter.Mov(dst, src);
+		emitter.Mov(src, RAX);
+		break;
+	}
+	case InstructionMnemonic::MOV:
+		emitter.Mov(dst, RCX);
+		EmitFlagsZN(emitter, RCX);
+		break;
+	case InstructionMnemonic::ADD:
+	case InstructionMnemonic::SUB:
+	case InstructionMnemonic::CMP:
+	{
+		bool add = (instruction.code == InstructionMnemonic::ADD);
+		emitter.Mov(RAX, dst);
+		emitter.Mov(RDX, RAX);
+		emitter.Operation(add ? OPCODE_ADD : OPCODE_SUB, RDX, RCX);
+		EmitFlagsOC(emitter, add ? JIT_FLAGS_ADD : (instruction.code == InstructionMnemonic::SUB ? JIT_FLAGS_SUB : JIT_FLAGS_CMP));
+		emitter.Movzx16(RDX, RDX);
+		if (instruction.code != InstructionMnemonic::CMP)
+			emitter.Mov(dst, RDX);
+		EmitFlagsZN(emitter, RDX);
+		break;
+	}
+	case InstructionMnemonic::SHL:
+	case InstructionMnemonic::SHR:
+		// interpreter computes C of shifts with CMP rules
+		emitter.Mov(RAX, dst);
+		emitter.Mov(RDX, RAX);
+		emitter.ShiftCl(instruction.code == InstructionMnemonic::SHL ? HOST_SHL : HOST_SHR, RDX);
+		EmitFlagsOC(emitter, JIT_FLAGS_CMP);
+		emitter.Movzx16(RDX, RDX);
+		emitter.Mov(dst, RDX);
+		EmitFlagsZN(emitter, RDX);
+		break;
+	case InstructionMnemonic::MUL:
+		emitter.Mov(RDX, dst);
+		emitter.Imul(RDX, RCX);
+		emitter.Movzx16(RDX, RDX);
+		emitter.Mov(dst, RDX);
+		EmitFlagsZN(emitter, RDX);
+		break;
+	case InstructionMnemonic::NOT:
+		emitter.Mov(RDX, dst);
+		emitter.Not(RDX);
+		emitter.Movzx16(RDX, RDX);
+		emitter.Mov(dst, RDX);
+		EmitFlagsZN(emitter, RDX);
+		break;
+	case InstructionMnemonic::AND:
+	case InstructionMnemonic::OR:
+	case InstructionMnemonic::XOR:
+	case InstructionMnemonic::TEST:
+	{
+		uint8_t opcode = (instruction.code == InstructionMnemonic::OR ? OPCODE_OR : (instruction.code == InstructionMnemonic::XOR ? OPCODE_XOR : OPCODE_AND));
+		emitter.Mov(RDX, dst);
+		emitter.Operation(opcode, RDX, RCX);
+		if (instruction.code != InstructionMnemonic::TEST)
+			emitter.Mov(dst, RDX);
+		EmitFlagsZN(emitter, RDX);
+		break;
+	}
+	}
+}
+
+void JITCompiler::EmitBranch(X86Emitter& emitter, const JITInstruction& instruction, uint16_t nextPC)
+{
+	// same target JumpTarget computes
+	uint16_t target = instruction.operand[0];
+	if (instruction.addressingType[0] == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET && instruction.registerSelector[0] == PC_REGISTER)
+		target += nextPC;
+
+	size_t taken;
+	switch (instruction.code)
+	{
+	case InstructionMnemonic::JEQ:
+		emitter.TestImmediate(HOST_PSW, FLAG_Z);
+		taken = emitter.JumpIf(CONDITION_NZ);
+		break;
+	case InstructionMnemonic::JNE:
+		emitter.TestImmediate(HOST_PSW, FLAG_Z);
+		taken = emitter.JumpIf(CONDITION_Z);
+		break;
+	case InstructionMnemonic::JGT:
+		// N (bit 3) shifted onto O (bit 1); jump when they are equal
+		emitter.Mov(RAX, HOST_PSW);
+		emitter.ShiftImmediate(HOST_SHR, RAX, 2);
+		emitter.Operation(OPCODE_XOR, RAX, HOST_PSW);
+		emitter.TestImmediate(RAX, FLAG_O);
+		taken = emitter.JumpIf(CONDITION_Z);
+		break;
+	default:
+		EmitExit(emitter, target);
+		return;
+	}
+
+	EmitExit(emitter, nextPC);
+	emitter.PatchJump(taken);
+	EmitExit(emitter, target);
+}
+
+TranslatedBlock* JITCompiler::Translate(uint16_t startPC)
+{
+	if (!codeBuffer)
+		return 0;
+
+	if (codeSize + JIT_MAX_BLOCK_CODE > JIT_CODE_BUFFER_SIZE)
+		Flush();
+
+	X86Emitter emitter(codeBuffer + codeSize);
+	EmitPrologue(emitter);
+
+	uint32_t pc = startPC;
+	int numberOfInstructions = 0;
+	bool endsWithBranch = false;
+	JITInstruction instruction;
+
+	while (numberOfInstructions < JIT_MAX_BLOCK_INSTRUCTIONS && Decode(executable->memory, pc, instruction) && CanTranslate(instruction, pc) &&
+		!IsIdleLoop(executable->memory, instruction, pc))
+	{
+		uint16_t nextPC = pc + instruction.length;
+		numberOfInstructions++;
+		pc = nextPC;
+
+		if (IsBranch(instruction))
+		{
+			EmitBranch(emitter, instruction, nextPC);
+			endsWithBranch = true;
+			break;
+		}
+
+		EmitInstruction(emitter, instruction, nextPC);
+	}
+
+	// first instruction has to be interpreted; execution count stays at threshold so it is not retried
+	if (numberOfInstructions == 0)
+		return 0;
+
+	if (!endsWithBranch)
+		EmitExit(emitter, pc);
+
+	TranslatedBlock* block = new TranslatedBlock();
+	block->startPC = startPC;
+	block->endPC = pc;
+	block->numberOfInstructions = numberOfInstructions;
+	block->code = (TranslatedCode)(codeBuffer + codeSize);
+
+	// keep blocks 16 byte aligned
+	codeSize = (codeSize + emitter.Size() + 15) & ~(size_t)15;
+
+	blocks[startPC] = block;
+	translatedBlocks.push_back(block);
+	for (uint32_t page = block->startPC / JIT_PAGE_SIZE; page <= (block->endPC - 1) / JIT_PAGE_SIZE; page++)
+		pageBlocks[page]++;
+
+	return block;
+}
\ No newline at end of file
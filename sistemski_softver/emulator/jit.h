@@ -0,0 +1,125 @@
+#ifndef _JIT_EMULATOR_H
+#define _JIT_EMULATOR_H
+
+#include "cpu.h"
+#include "executable.h"
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+// translation is supported only when emulator itself runs on x86-64
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+#define JIT_CODE_BUFFER_SIZE (4 * 1024 * 1024)
+// number of times instruction has to be interpreted before block starting with it gets translated
+#define JIT_HOT_THRESHOLD 16
+#define JIT_MAX_BLOCK_INSTRUCTIONS 64
+// upper bound of host code emitted for one guest instruction, prologue or exit
+#define JIT_MAX_INSTRUCTION_CODE 256
+#define JIT_MAX_BLOCK_CODE ((JIT_MAX_BLOCK_INSTRUCTIONS + 4) * JIT_MAX_INSTRUCTION_CODE)
+#define JIT_PAGE_SIZE 256
+
+// guest state translated block works on
+struct JITContext
+{
+	uint16_t* registerFile;
+	uint16_t* psw;
+	uint8_t* memory;
+};
+
+typedef void (*TranslatedCode)(JITContext* context);
+
+struct TranslatedBlock
+{
+	uint16_t startPC;
+	// address after last translated instruction
+	uint32_t endPC;
+	// guest instructions executed by one run of the block
+	uint16_t numberOfInstructions;
+	TranslatedCode code;
+};
+
+// instruction decoded without touching processor state
+struct JITInstruction
+{
+	uint8_t code;
+	OperandSize operandSize;
+	uint8_t numberOfOperands;
+	uint8_t length;
+
+	AddressingType addressingType[2];
+	uint8_t registerSelector[2];
+	// register half of byte operations on registers, NOT_APPLICABLE otherwise
+	ByteSelector byteSelector[2];
+	uint16_t operand[2];
+};
+
+enum JITFlagTable
+{
+	JIT_FLAGS_ADD = 0,
+	JIT_FLAGS_SUB,
+	JIT_FLAGS_CMP
+};
+
+class X86Emitter;
+
+class JITCompiler
+{
+
+private:
+	CPU& processor;
+	Executable* executable;
+	JITContext context;
+
+	uint8_t* codeBuffer = 0;
+	size_t codeSize = 0;
+
+	TranslatedBlock* blocks[MEMORY_ADDRESS_SPACE] = {};
+	uint16_t executionCount[MEMORY_ADDRESS_SPACE] = {};
+	// number of translated blocks covering each page
+	uint16_t pageBlocks[MEMORY_ADDRESS_SPACE / JIT_PAGE_SIZE] = {};
+	vector<TranslatedBlock*> translatedBlocks;
+
+	// psw O and C bits indexed by signs of source, destination and result
+	uint16_t flagTables[3][8];
+
+	void EmitPrologue(X86Emitter& emitter);
+	void EmitExit(X86Emitter& emitter, uint16_t pc);
+	void EmitSource(X86Emitter& emitter, const JITInstruction& instruction, uint16_t nextPC);
+	void EmitFlagsZN(X86Emitter& emitter, int result);
+	void EmitFlagsOC(X86Emitter& emitter, JITFlagTable table);
+	void EmitInstruction(X86Emitter& emitter, const JITInstruction& instruction, uint16_t nextPC);
+	void EmitBranch(X86Emitter& emitter, const JITInstruction& instruction, uint16_t nextPC);
+
+	TranslatedBlock* Translate(uint16_t pc);
+	void RemoveBlock(TranslatedBlock* block);
+	void Flush();
+
+public:
+	JITCompiler(CPU& processor, Executable* executable);
+	~JITCompiler();
+
+	// runs processor until it halts, executing translated blocks where possible
+	void Run();
+	void Invalidate(const uint16_t& address);
+
+	// translates block starting at pc right away, as if it were hot already
+	void Preload(uint16_t pc);
+	void GetBlockStarts(vector<uint16_t>& starts);
+
+	// shared with ahead-of-time translator, which recovers the same blocks statically
+	static bool Decode(const uint8_t* memory, uint16_t pc, JITInstruction& instruction);
+	static bool CanTranslate(const JITInstruction& instruction, uint16_t pc);
+	static bool IsBranch(const JITInstruction& instruction);
+	// jump to itself or back over constant moves into registers, left to interpreter
+	// which sleeps there until an interrupt arrives
+	static bool IsIdleLoop(const uint8_t* memory, const JITInstruction& instruction, uint16_t pc);
+	// true if [start, end) holds nothing but moves of constants into registers
+	static bool IsIdleLoopBody(const uint8_t* memory, uint16_t start, uint16_t end);
+};
+
+#endif
\ No newline at end of file
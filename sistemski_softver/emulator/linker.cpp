@@ -57,9 +57,9 @@ void Linker::MergeAndLoadExecutable()
 			// checking if linker caller specified where this section should be loaded
 			if (location.find(entry.name) == location.end())
 				throw LinkerException("Call linker with specifying loading address of '" + entry.name + "' section.", ErrorCodes::LINKER_SECTION_ADDRESS_UNSPECIFIED);
-			else if (executable->sectionTable.GetEntryByName(entry.name))
+			else if (executable->sectionTable->GetEntryByName(entry.name))
 			{
-				if (executable->sectionTable.GetEntryByName(entry.name)->flags != entry.flags)
+				if (executable->sectionTable->GetEntryByName(entry.name)->flags != entry.flags)
 					throw LinkerException("Unconsistent flags detected while joining section named '" + entry.name + "'.", ErrorCodes::LINKER_UNCONSISTENT_FLAGS);
 			}
 
@@ -91,10 +91,10 @@ void Linker::MergeAndLoadExecutable()
 
 					symbol.tokenType = TokenType::SYMBOL; // TNS directive to symbol
 
-					if (executable->symbolTable.GetEntryByName(symbol.name))
+					if (executable->symbolTable->GetEntryByName(symbol.name))
 						throw LinkerException("Multiple definition of symbol '" + symbol.name + "' in provided object files.", ErrorCodes::LINKER_MULTIPLE_SYMBOL_DEFINITION);
 					
-					executable->symbolTable.InsertSymbol(symbol);
+					executable->symbolTable->InsertSymbol(symbol);
 				}
 			}
 
@@ -110,10 +110,10 @@ void Linker::MergeAndLoadExecutable()
 			// check for section overlaping
 			uint16_t newLength;
 			map<string, uint16_t>::const_iterator it;
-			if (!executable->sectionTable.GetEntryByName(entry.name))
+			if (!executable->sectionTable->GetEntryByName(entry.name))
 				newLength = sectionStartMap.at(entry.name) + (uint16_t)entry.length;
 			else
-				newLength = (uint16_t)executable->sectionTable.GetEntryByName(entry.name)->length + (uint16_t)entry.length;
+				newLength = (uint16_t)executable->sectionTable->GetEntryByName(entry.name)->length + (uint16_t)entry.length;
 			for (it = sectionStartMap.begin(); it != sectionStartMap.end(); it++)
 			{
 				if ((it->second <= addressToWriteTo) && 
@@ -129,19 +129,19 @@ void Linker::MergeAndLoadExecutable()
 			// updating current section pointer for future merging
 			location.find(entry.name)->second = addressToWriteTo;
 
-			if (executable->sectionTable.GetEntryByName(entry.name))
-				executable->sectionTable.GetEntryByName(entry.name)->length += k;
+			if (executable->sectionTable->GetEntryByName(entry.name))
+				executable->sectionTable->GetEntryByName(entry.name)->length += k;
 			else
 			{
-				SectionID sid = executable->sectionTable.InsertSection(entry.name, entry.length, entry.flags, 0);
-				SymbolTableID no = executable->symbolTable.InsertSymbol(entry.name,
+				SectionID sid = executable->sectionTable->InsertSection(entry.name, entry.length, entry.flags, 0);
+				SymbolTableID no = executable->symbolTable->InsertSymbol(entry.name,
 					sid,
 					ASM_UNDEFINED,
 					ASM_UNDEFINED,
 					ScopeType::LOCAL,
 					TokenType::SECTION);
 
-				executable->sectionTable.GetEntryByID(sid)->symbolTableEntryNo = no;
+				executable->sectionTable->GetEntryByID(sid)->symbolTableEntryNo = no;
 			}
 		}
 	}
@@ -158,9 +158,9 @@ void Linker::ResolveRelocations()
 		{
 			const RelocationTableEntry& entry = *relocationTable.GetEntryByID((RelocationID)j);
 
-			if (executable->symbolTable.GetEntryByName(objectFile.GetSymbolTable().GetEntryByID(entry.symbolNo)->name))
+			if (executable->symbolTable->GetEntryByName(objectFile.GetSymbolTable().GetEntryByID(entry.symbolNo)->name))
 			{
-				SymbolTableEntry& symbol = *executable->symbolTable.GetEntryByName(objectFile.GetSymbolTable().GetEntryByID(entry.symbolNo)->name);
+				SymbolTableEntry& symbol = *executable->symbolTable->GetEntryByName(objectFile.GetSymbolTable().GetEntryByID(entry.symbolNo)->name);
 
 				if (symbol.sectionNumber != entry.sectionNo &&
 					(&objectFile != GetObjectFile(symbol)) &&
@@ -211,12 +211,12 @@ void Linker::ResolveRelocations()
 void Linker::ResolveStartSymbol()
 {
 	// look for emulator entry point (START_SYMBOL)
-	for (size_t i = 0; i < executable->symbolTable.GetSize(); i++)
+	for (size_t i = 0; i < executable->symbolTable->GetSize(); i++)
 	{
-		if (executable->symbolTable.GetEntryByID((SymbolTableID)i)->name == START_SYMBOL)
+		if (executable->symbolTable->GetEntryByID((SymbolTableID)i)->name == START_SYMBOL)
 		{
 			executable->initialPCDefined = true;
-			executable->initialPC = (uint16_t)executable->symbolTable.GetEntryByID((SymbolTableID)i)->offset;
+			executable->initialPC = (uint16_t)executable->symbolTable->GetEntryByID((SymbolTableID)i)->offset;
 			return;
 		}
 	}
@@ -229,12 +229,12 @@ void Linker::DeleteLocalSymbols()
 {
 	vector<SymbolTableID> v;
 
-	for (size_t i = 0; i < executable->symbolTable.GetSize(); i++)
-		if (executable->symbolTable.GetEntryByID((SymbolTableID)i)->scopeType == ScopeType::LOCAL)
+	for (size_t i = 0; i < executable->symbolTable->GetSize(); i++)
+		if (executable->symbolTable->GetEntryByID((SymbolTableID)i)->scopeType == ScopeType::LOCAL)
 			v.push_back((SymbolTableID)i);
 
 	for (size_t i = 0; i < v.size(); i++)
-		executable->symbolTable.DeleteSymbol(v.at((SymbolTableID)i));
+		executable->symbolTable->DeleteSymbol(v.at((SymbolTableID)i));
 }
 
 void Linker::CheckForNotProvidedFiles()
@@ -242,7 +242,7 @@ void Linker::CheckForNotProvidedFiles()
 	LinkerSections::const_iterator it;
 	for (it = sectionStartMap.begin(); it != sectionStartMap.end(); it++)
 	{
-		if (!executable->sectionTable.GetEntryByName(it->first))
+		if (!executable->sectionTable->GetEntryByName(it->first))
 			throw LinkerException("Section '" + it->first + "' is missing from provided object files to be linked.", ErrorCodes::LINKER_SECTION_MISSING);
 	}
 }
@@ -264,7 +264,7 @@ void Linker::ResolveTNS()
 		for (size_t obj = 0; obj < numberOfFiles; obj++)
 		{
 			TNSTable& tns = objectFiles[obj]->GetTNSTable();
-			SymbolTable& symbolTable = executable->symbolTable;
+			SymbolTable& symbolTable = *executable->symbolTable;
 
 			for (size_t i = 0; i < tns.GetSize(); i++)
 			{
@@ -306,6 +306,7 @@ Executable* Linker::GetExecutable()
 	ResolveStartSymbol();
 	DeleteLocalSymbols();
 	CheckForNotProvidedFiles();
+	executable->BuildPermissionTable();
 
 	return executable;
 }
@@ -3,8 +3,11 @@
 
 #include "linker.h"
 #include "emulator.h"
+#include "farm.h"
+#include "forkserver.h"
 
 #include <iostream>
+#include <memory>
 #include <regex>
 #include <vector>
 using namespace std;
@@ -15,8 +18,42 @@ int main(int argc, char** argv)
 	{
 		LinkerSections sections;
 		vector<string> inputFiles;
+		ExecutionEngine engine = ExecutionEngine::SWITCH_DISPATCH;
+		string translationCacheFile;
+		string fusionTableFile;
+		bool fusionTraining = false;
+		uint16_t batchSize = 1;
+		uint32_t timerInstructionsPerMs = 0;
+		bool headless = false;
+		string inputFile;
+		uint32_t inputRate = 1000;
+		string diskImageFile;
+		uint64_t instructionBudget = 0;
+		string farmManifestFile;
+		unsigned farmWorkers = 0;
+		string checkpointFile;
+		uint64_t checkpointInterval = CHECKPOINT_DEFAULT_INTERVAL;
+		string resumeFile;
+		bool forkServer = false;
+		bool forkServerUsesFork = true;
 		
 		regex placeRegex("^-place=\\.{0,1}[a-zA-Z_][a-zA-Z0-9_]*@0x[0-9a-fA-F]{1,4}$");
+		regex engineRegex("^-engine=(switch|threaded|specialized|jit)$");
+		regex cacheRegex("^-cache=.+$");
+		regex fusionRegex("^-fusion(-train){0,1}=.+$");
+		regex batchRegex("^-batch=[1-9][0-9]{0,3}$");
+		regex virtualTimerRegex("^-vtimer=[1-9][0-9]{0,5}$");
+		regex headlessRegex("^-headless$");
+		regex inputRegex("^-input=.+$");
+		regex inputRateRegex("^-input-rate=[1-9][0-9]{0,8}$");
+		regex diskRegex("^-disk=.+$");
+		regex budgetRegex("^-budget=[0-9]{1,18}$");
+		regex farmRegex("^-farm=.+$");
+		regex threadsRegex("^-threads=[1-9][0-9]{0,3}$");
+		regex checkpointRegex("^-checkpoint=.+$");
+		regex checkpointIntervalRegex("^-checkpoint-every=[1-9][0-9]{0,17}$");
+		regex resumeRegex("^-resume=.+$");
+		regex forkServerRegex("^-fork-server(=(fork|snapshot)){0,1}$");
 		regex inputFileRegex("^(\\\\?([^\\/]*[\\/])*)([^\\/]+)$");
 
 		for (int i = 1; i < argc; i++)
@@ -30,6 +67,79 @@ int main(int argc, char** argv)
 
 				sections.insert({ sectionName, location });
 			}
+			else if (regex_match(input, engineRegex))
+			{
+				if (input.substr(input.find('=') + 1) == "threaded")
+					engine = ExecutionEngine::THREADED_DISPATCH;
+				else if (input.substr(input.find('=') + 1) == "specialized")
+					engine = ExecutionEngine::SPECIALIZED_DISPATCH;
+				else if (input.substr(input.find('=') + 1) == "jit")
+					engine = ExecutionEngine::JIT_DISPATCH;
+				else
+					engine = ExecutionEngine::SWITCH_DISPATCH;
+			}
+			else if (regex_match(input, cacheRegex))
+			{
+				translationCacheFile = input.substr(input.find('=') + 1);
+			}
+			else if (regex_match(input, fusionRegex))
+			{
+				fusionTableFile = input.substr(input.find('=') + 1);
+				fusionTraining = (input.find("-fusion-train=") == 0);
+			}
+			else if (regex_match(input, batchRegex))
+			{
+				batchSize = (uint16_t)strtol(input.substr(input.find('=') + 1).c_str(), 0, 10);
+			}
+			else if (regex_match(input, virtualTimerRegex))
+			{
+				timerInstructionsPerMs = (uint32_t)strtol(input.substr(input.find('=') + 1).c_str(), 0, 10);
+			}
+			else if (regex_match(input, headlessRegex))
+			{
+				headless = true;
+			}
+			else if (regex_match(input, inputRegex))
+			{
+				inputFile = input.substr(input.find('=') + 1);
+			}
+			else if (regex_match(input, inputRateRegex))
+			{
+				inputRate = (uint32_t)strtoul(input.substr(input.find('=') + 1).c_str(), 0, 10);
+			}
+			else if (regex_match(input, diskRegex))
+			{
+				diskImageFile = input.substr(input.find('=') + 1);
+			}
+			else if (regex_match(input, budgetRegex))
+			{
+				instructionBudget = strtoull(input.substr(input.find('=') + 1).c_str(), 0, 10);
+			}
+			else if (regex_match(input, farmRegex))
+			{
+				farmManifestFile = input.substr(input.find('=') + 1);
+			}
+			else if (regex_match(input, threadsRegex))
+			{
+				farmWorkers = (unsigned)strtoul(input.substr(input.find('=') + 1).c_str(), 0, 10);
+			}
+			else if (regex_match(input, checkpointRegex))
+			{
+				checkpointFile = input.substr(input.find('=') + 1);
+			}
+			else if (regex_match(input, checkpointIntervalRegex))
+			{
+				checkpointInterval = strtoull(input.substr(input.find('=') + 1).c_str(), 0, 10);
+			}
+			else if (regex_match(input, resumeRegex))
+			{
+				resumeFile = input.substr(input.find('=') + 1);
+			}
+			else if (regex_match(input, forkServerRegex))
+			{
+				forkServer = true;
+				forkServerUsesFork = (input != "-fork-server=snapshot");
+			}
 			else if (regex_match(input, inputFileRegex))
 			{
 				inputFiles.push_back(input);
@@ -40,12 +150,73 @@ int main(int argc, char** argv)
 
 		try
 		{
-			Linker linker(inputFiles, sections);
-			Executable* executable = linker.GetExecutable();
-			cout << "Object files have been linked successfully." << endl;
+			// jobs carry their own object files and placement
+			if (!farmManifestFile.empty())
+			{
+				Farm farm(farmManifestFile, engine);
+				if (timerInstructionsPerMs)
+					farm.UseVirtualTimer(timerInstructionsPerMs);
+				farm.SetInputRate(inputRate);
+				farm.Run(farmWorkers);
+				farm.PrintStatistics(cout);
+
+				return farm.FailedJobs() ? 1 : 0;
+			}
+
+			// checkpoint carries memory and sections, so neither object files nor linker are needed
+			unique_ptr<Snapshot> checkpoint;
+			Executable* executable;
+			if (!resumeFile.empty())
+			{
+				checkpoint.reset(new Snapshot());
+				executable = Checkpoint::Load(resumeFile, *checkpoint);
+			}
+			else
+			{
+				Linker linker(inputFiles, sections);
+				executable = linker.GetExecutable();
+				// headless output carries nothing but what the program printed
+				if (!headless && !forkServer)
+					cout << "Object files have been linked successfully." << endl;
+			}
 			
-			Emulator emulator(executable);
-			emulator.Start();
+			Emulator emulator(executable, engine);
+			if (!translationCacheFile.empty())
+				emulator.UseTranslationCache(translationCacheFile);
+			if (!fusionTableFile.empty())
+				emulator.UseFusionTable(fusionTableFile, fusionTraining);
+			emulator.SetBatchSize(batchSize);
+			if (timerInstructionsPerMs)
+				emulator.UseVirtualTimer(timerInstructionsPerMs);
+			if (headless)
+				emulator.UseHeadlessMode();
+			if (!inputFile.empty())
+				emulator.UseInputFile(inputFile, inputRate);
+			if (!diskImageFile.empty())
+				emulator.UseDiskImage(diskImageFile);
+
+			// jobs with their input and output come from standard input, one per line
+			if (forkServer)
+			{
+				ForkServer server(emulator, forkServerUsesFork);
+				server.SetInputRate(inputRate);
+				server.SetInstructionBudget(instructionBudget);
+				server.Serve(cin, cout);
+				emulator.Finish();
+
+				return server.FailedJobs() ? 1 : 0;
+			}
+
+			emulator.SetInstructionBudget(instructionBudget);
+			if (!checkpointFile.empty())
+				emulator.UseCheckpoints(checkpointFile, checkpointInterval);
+			if (checkpoint)
+				emulator.StartFromSnapshot(*checkpoint);
+			else
+				emulator.Start();
+
+			if (headless)
+				return emulator.GetExitStatus();
 		}
 		catch (const LinkerException& ex)
 		{
@@ -0,0 +1,30 @@
+#ifndef _MAPPEDFILE_EMULATOR_H
+#define _MAPPEDFILE_EMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// read-only view of a whole file; platform headers are kept out of the
+// rest of the emulator because they clash with instruction mnemonics (INT)
+class MappedFile
+{
+
+private:
+	const uint8_t* data = 0;
+	size_t size = 0;
+	void* fileHandle = 0;
+	void* mappingHandle = 0;
+
+public:
+	~MappedFile() { Close(); }
+
+	bool Open(const string& fileName);
+	void Close();
+
+	inline const uint8_t* Data() const { return data; }
+	inline size_t Size() const { return size; }
+};
+
+#endif
\ No newline at end of file
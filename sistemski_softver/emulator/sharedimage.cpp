@@ -0,0 +1,82 @@
+#include "sharedimage.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool SharedImage::Create(const uint8_t* data, size_t size)
+{
+	if (size == 0 || this->size != 0)
+		return false;
+
+#ifdef _WIN32
+	// section backed by paging file; FILE_MAP_COPY views of it are copy-on-write
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, (DWORD)size, 0);
+	if (!mapping)
+		return false;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+	if (!view)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	memcpy(view, data, size);
+	UnmapViewOfFile(view);
+
+	mappingHandle = mapping;
+#else
+	file = memfd_create("emulator-image", MFD_CLOEXEC);
+	if (file < 0)
+		return false;
+
+	if (ftruncate(file, size) != 0 || pwrite(file, data, size, 0) != (ssize_t)size)
+	{
+		close(file);
+		file = -1;
+		return false;
+	}
+#endif
+
+	this->size = size;
+	return true;
+}
+
+SharedImage::~SharedImage()
+{
+	if (size == 0)
+		return;
+
+	// views that are still mapped stay valid
+#ifdef _WIN32
+	CloseHandle(mappingHandle);
+#else
+	close(file);
+#endif
+}
+
+uint8_t* SharedImage::Map() const
+{
+	if (size == 0)
+		return 0;
+
+#ifdef _WIN32
+	return (uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, size);
+#else
+	void* view = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	return view == MAP_FAILED ? 0 : (uint8_t*)view;
+#endif
+}
+
+void SharedImage::Unmap(uint8_t* view, size_t size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(view);
+#else
+	munmap(view, size);
+#endif
+}
\ No newline at end of file
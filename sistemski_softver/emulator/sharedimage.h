@@ -0,0 +1,31 @@
+#ifndef _SHAREDIMAGE_EMULATOR_H
+#define _SHAREDIMAGE_EMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+// read-only copy of loaded memory kept by the operating system; every view of
+// it is private and writable, and a page is duplicated only once its view
+// writes to it, so untouched code and data exist once for all instances
+class SharedImage
+{
+
+private:
+	size_t size = 0;
+	// paging file backed section on Windows, memfd elsewhere
+	void* mappingHandle = 0;
+	int file = -1;
+
+public:
+	~SharedImage();
+
+	// false if image cannot be shared, callers then copy memory themselves
+	bool Create(const uint8_t* data, size_t size);
+
+	// returns 0 on failure
+	uint8_t* Map() const;
+	static void Unmap(uint8_t* view, size_t size);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef _SNAPSHOT_EMULATOR_H
+#define _SNAPSHOT_EMULATOR_H
+
+#include "executable.h"
+#include <cstdint>
+
+// complete machine state at an instruction boundary; host streams (terminal
+// output already written, position in input file, disk image) are not part of it
+struct Snapshot
+{
+	// first, so it is aligned for word compares
+	uint8_t memory[MEMORY_ADDRESS_SPACE];
+
+	// identifies snapshot executable tracks dirty pages against, 0 if never taken
+	uint64_t generation = 0;
+
+	uint16_t registerFile[8];
+	uint16_t psw;
+	bool halted;
+	bool initializationFinished;
+	uint8_t pendingInterrupts;
+	uint8_t timerConfiguration;
+
+	// virtual time and deadlines measured in it
+	uint64_t instructionCount;
+	uint64_t timerDeadline;
+	uint64_t inputDeadline;
+	uint64_t budgetDeadline;
+	bool budgetExhausted;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "threaded.h"
+
+#if THREADED_COMPUTED_GOTO
+#define HANDLER(mnemonic) L_##mnemonic
+#define DISPATCH() goto *dispatchTable[processor.instructionMnemonic & (DISPATCH_TABLE_SIZE - 1)]
+#else
+#define HANDLER(mnemonic) case InstructionMnemonic::mnemonic
+#define DISPATCH() goto dispatch
+#endif
+
+// replicated in every handler so each one has its own indirect jump
+#define NEXT() \
+	processor.InstructionHandleInterrupt(); \
+	if (processor.halted) \
+		return; \
+	processor.InstructionFetchAndDecode(); \
+	if (!processor.InstructionPrologue()) \
+		goto skip; \
+	DISPATCH()
+
+#define EXECUTE(mnemonic, method) \
+	HANDLER(mnemonic): \
+		processor.method(); \
+		processor.InstructionEpilogue(); \
+		NEXT()
+
+void ThreadedInterpreter::Run(CPU& processor)
+{
+#if THREADED_COMPUTED_GOTO
+	// indexed by operation code, DO NOT CHANGE THE ORDER HERE
+	static void* const dispatchTable[DISPATCH_TABLE_SIZE] = {
+		&&L_INVALID,
+		&&L_HALT, &&L_XCHG, &&L_INT, &&L_MOV, &&L_ADD, &&L_SUB, &&L_MUL, &&L_DIV,
+		&&L_CMP, &&L_NOT, &&L_AND, &&L_OR, &&L_XOR, &&L_TEST, &&L_SHL, &&L_SHR,
+		&&L_PUSH, &&L_POP, &&L_JMP, &&L_JEQ, &&L_JNE, &&L_JGT, &&L_CALL, &&L_RET,
+		&&L_IRET, &&L_WAIT,
+		&&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID
+	};
+#endif
+
+	if (processor.halted)
+		return;
+	processor.InstructionFetchAndDecode();
+	if (!processor.InstructionPrologue())
+		goto skip;
+	DISPATCH();
+
+#if !THREADED_COMPUTED_GOTO
+dispatch:
+	switch (processor.instructionMnemonic)
+	{
+#endif
+	EXECUTE(HALT, ExecuteHalt);
+	EXECUTE(XCHG, ExecuteXchg);
+	EXECUTE(INT, ExecuteInt);
+	EXECUTE(MOV, ExecuteMov);
+	EXECUTE(ADD, ExecuteAdd);
+	EXECUTE(SUB, ExecuteSub);
+	EXECUTE(MUL, ExecuteMul);
+	EXECUTE(DIV, ExecuteDiv);
+	EXECUTE(CMP, ExecuteCmp);
+	EXECUTE(NOT, ExecuteNot);
+	EXECUTE(AND, ExecuteAnd);
+	EXECUTE(OR, ExecuteOr);
+	EXECUTE(XOR, ExecuteXor);
+	EXECUTE(TEST, ExecuteTest);
+	EXECUTE(SHL, ExecuteShl);
+	EXECUTE(SHR, ExecuteShr);
+	EXECUTE(PUSH, ExecutePush);
+	EXECUTE(POP, ExecutePop);
+	EXECUTE(JMP, ExecuteJmp);
+	EXECUTE(JEQ, ExecuteJeq);
+	EXECUTE(JNE, ExecuteJne);
+	EXECUTE(JGT, ExecuteJgt);
+	EXECUTE(CALL, ExecuteCall);
+	EXECUTE(RET, ExecuteRet);
+	EXECUTE(IRET, ExecuteIret);
+	EXECUTE(WAIT, ExecuteWait);
+#if THREADED_COMPUTED_GOTO
+	L_INVALID:
+#else
+	default:
+#endif
+		processor.SetInterrupt(InterruptType::INT_INVALID_INSTRUCTION);
+		processor.InstructionEpilogue();
+		NEXT();
+#if !THREADED_COMPUTED_GOTO
+	}
+#endif
+
+	// instruction was not executed because invalid instruction interrupt is pending
+skip:
+	NEXT();
+}
\ No newline at end of file
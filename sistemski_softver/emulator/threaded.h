@@ -0,0 +1,25 @@
+#ifndef _THREADED_EMULATOR_H
+#define _THREADED_EMULATOR_H
+
+#include "cpu.h"
+
+// labels as values are GCC/Clang extension; other compilers fall back to switch dispatch
+#if defined(__GNUC__) || defined(__clang__)
+#define THREADED_COMPUTED_GOTO 1
+#else
+#define THREADED_COMPUTED_GOTO 0
+#endif
+
+// number of entries in dispatch table (opcode field is 5 bits wide)
+#define DISPATCH_TABLE_SIZE ISA_NUMBER_OF_CODES
+
+class ThreadedInterpreter
+{
+
+public:
+	// runs processor until it halts, the same way Emulator::Run does, but every
+	// instruction handler fetches next instruction and jumps directly to its handler
+	static void Run(CPU& processor);
+};
+
+#endif
\ No newline at end of file
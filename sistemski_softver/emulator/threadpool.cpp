@@ -0,0 +1,68 @@
+#include "threadpool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned numberOfWorkers)
+{
+	if (numberOfWorkers == 0)
+		numberOfWorkers = thread::hardware_concurrency();
+	if (numberOfWorkers == 0)
+		numberOfWorkers = 1;
+
+	for (unsigned i = 0; i < numberOfWorkers; i++)
+		queues.push_back(unique_ptr<WorkerQueue>(new WorkerQueue()));
+}
+
+void WorkStealingPool::Submit(function<void()> task)
+{
+	queues[nextQueue]->tasks.push_back(move(task));
+	nextQueue = (nextQueue + 1) % queues.size();
+}
+
+bool WorkStealingPool::Pop(size_t worker, function<void()>& task)
+{
+	WorkerQueue& queue = *queues[worker];
+	lock_guard<mutex> lock(queue.lock);
+	if (queue.tasks.empty())
+		return false;
+
+	task = move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool WorkStealingPool::Steal(size_t worker, function<void()>& task)
+{
+	for (size_t i = 1; i < queues.size(); i++)
+	{
+		WorkerQueue& victim = *queues[(worker + i) % queues.size()];
+		lock_guard<mutex> lock(victim.lock);
+		if (victim.tasks.empty())
+			continue;
+
+		task = move(victim.tasks.front());
+		victim.tasks.pop_front();
+		return true;
+	}
+
+	return false;
+}
+
+void WorkStealingPool::Work(size_t worker)
+{
+	// nothing is submitted while pool runs, so once every queue is empty the worker is done
+	function<void()> task;
+	while (Pop(worker, task) || Steal(worker, task))
+		task();
+}
+
+void WorkStealingPool::Run()
+{
+	vector<thread> workers;
+	for (size_t i = 1; i < queues.size(); i++)
+		workers.push_back(thread(&WorkStealingPool::Work, this, i));
+
+	// calling thread is worker 0
+	Work(0);
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef _THREADPOOL_EMULATOR_H
+#define _THREADPOOL_EMULATOR_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// fixed set of workers, each with its own queue of tasks; worker whose queue
+// is empty takes tasks from the front of other queues, so a few long tasks
+// do not leave the rest of the cores idle
+class WorkStealingPool
+{
+
+private:
+	struct WorkerQueue
+	{
+		mutex lock;
+		deque<function<void()>> tasks;
+	};
+
+	vector<unique_ptr<WorkerQueue>> queues;
+	size_t nextQueue = 0;
+
+	// own tasks are taken from the back, stolen ones from the front
+	bool Pop(size_t worker, function<void()>& task);
+	bool Steal(size_t worker, function<void()>& task);
+	void Work(size_t worker);
+
+public:
+	// 0 stands for one worker per hardware thread
+	WorkStealingPool(unsigned numberOfWorkers = 0);
+
+	inline size_t NumberOfWorkers() const { return queues.size(); }
+	// tasks are dealt to workers in turn; none may be submitted while pool runs
+	void Submit(function<void()> task);
+	// returns once every submitted task has finished
+	void Run();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "translationcache.h"
+#include "mappedfile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+uint64_t TranslationCache::PayloadHash(const uint8_t* data, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ data[i]) * 1099511628211ULL;
+
+	return hash;
+}
+
+bool TranslationCache::IsConsistent(const TranslationCacheRecord& record, const uint8_t* memory)
+{
+	const DecodedInstruction& cached = record.instruction;
+	JITInstruction decoded;
+	if (!JITCompiler::Decode(memory, record.pc, decoded) || decoded.length != cached.length ||
+		decoded.code != cached.instructionCode || decoded.operandSize != cached.operandSize)
+		return false;
+
+	// addressing types of missing operands are whatever decoding of earlier instructions left behind
+	AddressingType mode1 = (decoded.numberOfOperands >= 1 ? decoded.addressingType[0] : cached.operand1AddressingType);
+	AddressingType mode2 = (decoded.numberOfOperands == 2 ? decoded.addressingType[1] : cached.operand2AddressingType);
+	if (cached.handlerIndex != CPU::SpecializedHandlerIndex(decoded.code, decoded.operandSize, mode1, mode2))
+		return false;
+
+	// only fields LoadDecodedOperand restores for the addressing type are compared
+	for (int i = 0; i < decoded.numberOfOperands; i++)
+	{
+		AddressingType addressingType = (i == 0 ? cached.operand1AddressingType : cached.operand2AddressingType);
+		uint8_t registerSelector = (i == 0 ? cached.registerSelector1 : cached.registerSelector2);
+		ByteSelector byteSelector = (i == 0 ? cached.operand1ByteSelector : cached.operand2ByteSelector);
+		uint16_t operand = (i == 0 ? cached.operand1 : cached.operand2);
+
+		if (addressingType != decoded.addressingType[i])
+			return false;
+
+		switch (addressingType)
+		{
+		case AddressingType::IMMEDIATELY:
+		case AddressingType::MEMORY_DIRECT:
+			if (operand != decoded.operand[i])
+				return false;
+			break;
+		case AddressingType::REGISTER_DIRECT:
+			if (registerSelector != decoded.registerSelector[i] || byteSelector != decoded.byteSelector[i])
+				return false;
+			break;
+		case AddressingType::REGISTER_INDIRECT_NO_OFFSET:
+			if (registerSelector != decoded.registerSelector[i])
+				return false;
+			break;
+		default:
+			if (registerSelector != decoded.registerSelector[i] || operand != decoded.operand[i])
+				return false;
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool TranslationCache::Load(Executable* executable, JITCompiler* jit)
+{
+	imageHash = executable->ImageHash();
+
+	MappedFile file;
+	if (!file.Open(fileName) || file.Size() < sizeof(TranslationCacheHeader))
+		return false;
+
+	TranslationCacheHeader header;
+	memcpy(&header, file.Data(), sizeof(header));
+
+	if (header.magic != TRANSLATION_CACHE_MAGIC || header.version != TRANSLATION_CACHE_VERSION ||
+		header.imageHash != imageHash || header.recordSize != sizeof(TranslationCacheRecord) ||
+		file.Size() != sizeof(header) + (size_t)header.numberOfRecords * sizeof(TranslationCacheRecord) + (size_t)header.numberOfBlocks * sizeof(uint16_t) ||
+		header.payloadHash != PayloadHash(file.Data() + sizeof(header), file.Size() - sizeof(header)))
+		return false;
+
+	// everything is checked before anything is used, so damaged file leaves both caches empty
+	const uint8_t* memory = &executable->MemoryRead(0);
+	const uint8_t* data = file.Data() + sizeof(header);
+	vector<TranslationCacheRecord> records;
+	for (uint32_t i = 0; i < header.numberOfRecords; i++, data += sizeof(TranslationCacheRecord))
+	{
+		TranslationCacheRecord record;
+		memcpy(&record, data, sizeof(record));
+
+		if (record.instruction.length == 0 || record.instruction.length > MAX_INSTRUCTION_LENGTH ||
+			record.pc + record.instruction.length > MEMORY_MAPPED_REGISTERS_START)
+			return false;
+
+		// program overwrote the instruction while it ran, it is decoded again if it is reached
+		if (memcmp(record.code, memory + record.pc, record.instruction.length) != 0)
+			continue;
+
+		if (!IsConsistent(record, memory))
+			return false;
+		records.push_back(record);
+	}
+
+	vector<uint16_t> blocks;
+	for (uint32_t i = 0; i < header.numberOfBlocks; i++, data += sizeof(uint16_t))
+	{
+		uint16_t pc;
+		memcpy(&pc, data, sizeof(pc));
+
+		if (pc >= MEMORY_MAPPED_REGISTERS_START)
+			return false;
+		blocks.push_back(pc);
+	}
+
+	DecodedInstructionCache& decodedCache = executable->GetDecodedCache();
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		records[i].instruction.superinstruction = 0;
+		decodedCache.Insert(records[i].pc, records[i].instruction);
+	}
+	loadedRecords = records.size();
+
+	if (jit)
+		for (size_t i = 0; i < blocks.size(); i++)
+			jit->Preload(blocks[i]);
+	loadedBlocks = blocks.size();
+
+	return true;
+}
+
+void TranslationCache::Save(Executable* executable, JITCompiler* jit)
+{
+	vector<TranslationCacheRecord> records;
+	DecodedInstructionCache& decodedCache = executable->GetDecodedCache();
+	for (uint32_t pc = 0; pc < MEMORY_MAPPED_REGISTERS_START; pc++)
+	{
+		const DecodedInstruction* decoded = decodedCache.Lookup(pc);
+		if (!decoded)
+			continue;
+
+		TranslationCacheRecord record = {};
+		record.pc = pc;
+		memcpy(record.code, &executable->MemoryRead(pc), decoded->length);
+		record.instruction = *decoded;
+		record.instruction.superinstruction = 0;
+		records.push_back(record);
+	}
+
+	vector<uint16_t> blocks;
+	if (jit)
+		jit->GetBlockStarts(blocks);
+
+	if (records.size() <= loadedRecords && blocks.size() <= loadedBlocks)
+		return;
+
+	TranslationCacheHeader header = {};
+	header.magic = TRANSLATION_CACHE_MAGIC;
+	header.version = TRANSLATION_CACHE_VERSION;
+	header.imageHash = imageHash;
+	header.recordSize = sizeof(TranslationCacheRecord);
+	header.numberOfRecords = (uint32_t)records.size();
+	header.numberOfBlocks = (uint32_t)blocks.size();
+
+	vector<uint8_t> payload(records.size() * sizeof(TranslationCacheRecord) + blocks.size() * sizeof(uint16_t));
+	if (!records.empty())
+		memcpy(payload.data(), records.data(), records.size() * sizeof(TranslationCacheRecord));
+	if (!blocks.empty())
+		memcpy(payload.data() + records.size() * sizeof(TranslationCacheRecord), blocks.data(), blocks.size() * sizeof(uint16_t));
+	header.payloadHash = PayloadHash(payload.data(), payload.size());
+
+	// written aside and renamed, so concurrent runs never map a half written file
+	string temporaryName = fileName + ".tmp";
+	ofstream output(temporaryName, ios::out | ios::binary | ios::trunc);
+	if (!output)
+		return;
+
+	output.write((const char*)&header, sizeof(header));
+	if (!payload.empty())
+		output.write((const char*)payload.data(), payload.size());
+	output.close();
+
+	if (!output)
+	{
+		remove(temporaryName.c_str());
+		return;
+	}
+
+	if (rename(temporaryName.c_str(), fileName.c_str()) != 0)
+	{
+		remove(fileName.c_str());
+		rename(temporaryName.c_str(), fileName.c_str());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef _TRANSLATIONCACHE_EMULATOR_H
+#define _TRANSLATIONCACHE_EMULATOR_H
+
+#include "decodecache.h"
+#include "executable.h"
+#include "jit.h"
+#include <cstdint>
+#include <string>
+using namespace std;
+
+// "EMTC" read as little endian word
+#define TRANSLATION_CACHE_MAGIC 0x43544D45
+// has to be increased whenever layout of records or meaning of their fields changes
+#define TRANSLATION_CACHE_VERSION 4
+
+struct TranslationCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	// hash of memory image and section layout cache was built for
+	uint64_t imageHash;
+	// FNV-1a hash of records and block start addresses
+	uint64_t payloadHash;
+	uint32_t recordSize;
+	uint32_t numberOfRecords;
+	uint32_t numberOfBlocks;
+	uint32_t reserved;
+};
+
+struct TranslationCacheRecord
+{
+	uint16_t pc;
+	// bytes instruction was decoded from, checked again before entry is used
+	uint8_t code[MAX_INSTRUCTION_LENGTH];
+	DecodedInstruction instruction;
+};
+
+// file layout: header, records of decoded instructions, start addresses of translated blocks
+class TranslationCache
+{
+
+private:
+	string fileName;
+	uint64_t imageHash = 0;
+
+	// file is rewritten only if run decoded or translated something new
+	size_t loadedRecords = 0;
+	size_t loadedBlocks = 0;
+
+	static uint64_t PayloadHash(const uint8_t* data, size_t length);
+	// record matches instruction decoded again from its bytes in memory
+	static bool IsConsistent(const TranslationCacheRecord& record, const uint8_t* memory);
+
+public:
+	TranslationCache(const string& fileName) : fileName(fileName) {}
+
+	// has to be called before emulation starts, while memory still holds the linked image;
+	// missing, stale or damaged file is ignored as a whole
+	bool Load(Executable* executable, JITCompiler* jit);
+	void Save(Executable* executable, JITCompiler* jit);
+};
+
+#endif
\ No newline at end of file
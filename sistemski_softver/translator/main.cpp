@@ -0,0 +1,81 @@
+#ifndef _MAIN_TRANSLATOR_H
+#define _MAIN_TRANSLATOR_H
+
+#include "../emulator/linker.h"
+#include "translator.h"
+
+#include <iostream>
+#include <regex>
+#include <vector>
+using namespace std;
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		LinkerSections sections;
+		vector<string> inputFiles;
+		string outputFile = "program.cpp";
+
+		regex placeRegex("^-place=\\.{0,1}[a-zA-Z_][a-zA-Z0-9_]*@0x[0-9a-fA-F]{1,4}$");
+		regex outputRegex("^-o=.+$");
+		regex inputFileRegex("^(\\\\?([^\\/]*[\\/])*)([^\\/]+)$");
+
+		for (int i = 1; i < argc; i++)
+		{
+			string input = argv[i];
+
+			if (regex_match(input, placeRegex))
+			{
+				string sectionName = input.substr(input.find('=') + 1, input.find('@') - input.find('=') - 1);
+				uint16_t location = (uint16_t)strtol(input.substr(input.find('@') + 1, input.size() - input.find('@')).c_str(), 0, 16);
+
+				sections.insert({ sectionName, location });
+			}
+			else if (regex_match(input, outputRegex))
+			{
+				outputFile = input.substr(input.find('=') + 1);
+			}
+			else if (regex_match(input, inputFileRegex))
+			{
+				inputFiles.push_back(input);
+			}
+			else
+				cout << "Invalid translator calling parameters." << endl;
+		}
+
+		try
+		{
+			Linker linker(inputFiles, sections);
+			Executable* executable = linker.GetExecutable();
+			cout << "Object files have been linked successfully." << endl;
+
+			Translator translator(executable, inputFiles);
+			translator.Translate(outputFile);
+			delete executable;
+			cout << "Program has been translated to '" << outputFile << "'." << endl;
+
+			return 0;
+		}
+		catch (const LinkerException& ex)
+		{
+			cout << ex << endl;
+		}
+		catch (const EmulatorException& ex)
+		{
+			cout << ex << endl;
+		}
+		catch (const exception& ex)
+		{
+			cout << "Unknown translator error: " << endl;
+			cout << ex.what() << endl;
+			cout << endl;
+		}
+
+		return 1;
+	}
+	else
+		cout << "Translator invocation required at least one parameter." << endl;
+}
+
+#endif
\ No newline at end of file
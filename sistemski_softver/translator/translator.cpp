@@ -0,0 +1,385 @@
+#include "translator.h"
+#include "../emulator/linker.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+static string Hex(uint32_t value)
+{
+	stringstream stream;
+	stream << "0x" << hex << uppercase << setw(4) << setfill('0') << value;
+	return stream.str();
+}
+
+static string Register(uint8_t registerSelector)
+{
+	return "r[" + to_string(registerSelector) + "]";
+}
+
+static uint16_t BranchTarget(const JITInstruction& instruction, uint16_t nextPC)
+{
+	// same target JumpTarget computes
+	uint16_t target = instruction.operand[0];
+	if (instruction.addressingType[0] == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET && instruction.registerSelector[0] == PC_REGISTER)
+		target += nextPC;
+
+	return target;
+}
+
+static bool HasStaticTarget(const JITInstruction& instruction)
+{
+	switch (instruction.addressingType[0])
+	{
+	case AddressingType::IMMEDIATELY:
+	case AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET:
+	case AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET:
+	case AddressingType::MEMORY_DIRECT:
+		return true;
+	}
+
+	return false;
+}
+
+bool Translator::IsExecutable(uint32_t address, uint32_t length)
+{
+	// unlike CheckIfExecutable, code is recovered only from sections marked executable
+	if (address + length > MEMORY_MAPPED_REGISTERS_START)
+		return false;
+
+	LinkerSections::const_iterator it;
+	for (it = executable->sectionStartMap.begin(); it != executable->sectionStartMap.end(); it++)
+	{
+		const SectionTableEntry* entry = executable->sectionTable->GetEntryByName(it->first);
+		if (entry && (entry->flags & FLAG_EXECUTABLE) && it->second <= address && address + length <= it->second + entry->length)
+			return true;
+	}
+
+	return false;
+}
+
+void Translator::AddEntry(uint32_t pc)
+{
+	if (pc >= MEMORY_MAPPED_REGISTERS_START || entries.count((uint16_t)pc))
+		return;
+
+	entries.insert((uint16_t)pc);
+	worklist.push_back((uint16_t)pc);
+}
+
+void Translator::AddSuccessors(const JITInstruction& instruction, uint16_t nextPC)
+{
+	switch (instruction.code)
+	{
+	case InstructionMnemonic::HALT:
+	case InstructionMnemonic::RET:
+	case InstructionMnemonic::IRET:
+		return;
+	case InstructionMnemonic::JMP:
+		if (HasStaticTarget(instruction))
+			AddEntry(BranchTarget(instruction, nextPC));
+		return;
+	case InstructionMnemonic::JEQ:
+	case InstructionMnemonic::JNE:
+	case InstructionMnemonic::JGT:
+	case InstructionMnemonic::CALL:
+		if (HasStaticTarget(instruction))
+			AddEntry(BranchTarget(instruction, nextPC));
+		break;
+	}
+
+	// interpreter executes instruction and translated code takes over again after it
+	AddEntry(nextPC);
+}
+
+void Translator::RecoverBlock(uint16_t startPC)
+{
+	vector<TranslatorInstruction> block;
+	JITInstruction instruction;
+	uint32_t pc = startPC;
+
+	while (true)
+	{
+		if (block.size() == TRANSLATOR_MAX_BLOCK_INSTRUCTIONS)
+		{
+			AddEntry(pc);
+			break;
+		}
+
+		if (!JITCompiler::Decode(executable->memory, pc, instruction) || !IsExecutable(pc, instruction.length))
+			break;
+
+		uint16_t nextPC = pc + instruction.length;
+		if (!JITCompiler::CanTranslate(instruction, pc) || JITCompiler::IsIdleLoop(executable->memory, instruction, pc))
+		{
+			AddSuccessors(instruction, nextPC);
+			break;
+		}
+
+		block.push_back({ (uint16_t)pc, instruction });
+		pc = nextPC;
+
+		if (JITCompiler::IsBranch(instruction))
+		{
+			AddSuccessors(instruction, nextPC);
+			break;
+		}
+	}
+
+	// first instruction has to be interpreted
+	if (!block.empty())
+		blocks[startPC] = block;
+}
+
+void Translator::Recover()
+{
+	// reset routine and interrupt routines are entered through interrupt vector table
+	for (uint16_t i = 0; i < IVT_LENGTH; i++)
+	{
+		uint16_t routine = executable->memory[IVT_START + 2 * i] | (executable->memory[IVT_START + 2 * i + 1] << 8);
+		if (IsExecutable(routine, 1))
+			AddEntry(routine);
+	}
+	AddEntry(executable->initialPC);
+
+	while (!worklist.empty())
+	{
+		uint16_t pc = worklist.back();
+		worklist.pop_back();
+		RecoverBlock(pc);
+	}
+}
+
+string Translator::Source(const JITInstruction& instruction, uint16_t nextPC)
+{
+	uint8_t registerSelector = instruction.registerSelector[1];
+	uint16_t operand = instruction.operand[1];
+
+	switch (instruction.addressingType[1])
+	{
+	case AddressingType::IMMEDIATELY:
+		return Hex(operand);
+	case AddressingType::REGISTER_DIRECT:
+		return registerSelector == PC_REGISTER ? Hex(nextPC) : Register(registerSelector);
+	case AddressingType::MEMORY_DIRECT:
+		return "runtime.Load16(" + Hex(operand) + ")";
+	default:
+	{
+		int16_t offset = 0;
+		if (instruction.addressingType[1] == AddressingType::REGISTER_INDIRECT_8_BIT_OFFSET)
+			offset = (int8_t)(operand & 0xFF);
+		else if (instruction.addressingType[1] == AddressingType::REGISTER_INDIRECT_16_BIT_OFFSET)
+			offset = (int16_t)operand;
+
+		if (registerSelector == PC_REGISTER)
+			return "runtime.Load16(" + Hex((uint16_t)(nextPC + offset)) + ")";
+		if (offset == 0)
+			return "runtime.Load16(" + Register(registerSelector) + ")";
+
+		return "runtime.Load16((uint16_t)(" + Register(registerSelector) + " + " + to_string(offset) + "))";
+	}
+	}
+}
+
+void Translator::EmitInstruction(ostream& output, const JITInstruction& instruction, uint16_t nextPC)
+{
+	// mirrors word forms of CPU::Execute* with register destination
+	string dst = Register(instruction.registerSelector[0]);
+	string src = instruction.numberOfOperands == 2 ? Source(instruction, nextPC) : "";
+
+	switch (instruction.code)
+	{
+	case InstructionMnemonic::XCHG:
+		output << "\t\t{ uint16_t temp = " << dst << "; " << dst << " = " << src << "; " << src << " = temp; }\n";
+		break;
+	case InstructionMnemonic::MOV:
+		output << "\t\t" << dst << " = " << src << ";\n";
+		output << "\t\truntime.FlagsZN((int16_t)" << dst << ");\n";
+		break;
+	case InstructionMnemonic::ADD:
+	case InstructionMnemonic::SUB:
+	{
+		const char* operation = instruction.code == InstructionMnemonic::ADD ? "ADD" : "SUB";
+		const char* sign = instruction.code == InstructionMnemonic::ADD ? " + " : " - ";
+		output << "\t\t{\n";
+		output << "\t\t\tuint16_t src = " << src << ", dst = " << dst << ";\n";
+		output << "\t\t\truntime.FlagO(src, dst, dst" << sign << "src, InstructionMnemonic::" << operation << ");\n";
+		output << "\t\t\truntime.FlagC(src, dst, dst" << sign << "src, InstructionMnemonic::" << operation << ");\n";
+		output << "\t\t\t" << dst << " = dst" << sign << "src;\n";
+		output << "\t\t\truntime.FlagsZN((int16_t)" << dst << ");\n";
+		output << "\t\t}\n";
+		break;
+	}
+	case InstructionMnemonic::MUL:
+		output << "\t\t" << dst << " = (uint16_t)((uint32_t)" << dst << " * " << src << ");\n";
+		output << "\t\truntime.FlagsZN((int16_t)" << dst << ");\n";
+		break;
+	case InstructionMnemonic::CMP:
+		output << "\t\t{\n";
+		output << "\t\t\tuint16_t src = " << src << ", dst = " << dst << ";\n";
+		output << "\t\t\tuint16_t temp = dst - src;\n";
+		output << "\t\t\truntime.FlagsZN((int16_t)temp);\n";
+		output << "\t\t\truntime.FlagC(src, dst, temp, InstructionMnemonic::CMP);\n";
+		output << "\t\t}\n";
+		break;
+	case InstructionMnemonic::NOT:
+		output << "\t\t" << dst << " = ~" << dst << ";\n";
+		output << "\t\truntime.FlagsZN((int16_t)" << dst << ");\n";
+		break;
+	case InstructionMnemonic::AND:
+	case InstructionMnemonic::OR:
+	case InstructionMnemonic::XOR:
+	{
+		const char* sign = instruction.code == InstructionMnemonic::AND ? " & " : (instruction.code == InstructionMnemonic::OR ? " | " : " ^ ");
+		output << "\t\t" << dst << " = " << dst << sign << src << ";\n";
+		output << "\t\truntime.FlagsZN((int16_t)" << dst << ");\n";
+		break;
+	}
+	case InstructionMnemonic::TEST:
+		output << "\t\truntime.FlagsZN((int16_t)(uint16_t)(" << dst << " & " << src << "));\n";
+		break;
+	case InstructionMnemonic::SHL:
+	case InstructionMnemonic::SHR:
+	{
+		const char* sign = instruction.code == InstructionMnemonic::SHL ? " << " : " >> ";
+		output << "\t\t{\n";
+		output << "\t\t\tuint16_t src = " << src << ", dst = " << dst << ";\n";
+		output << "\t\t\truntime.FlagC(src, dst, dst" << sign << "src, InstructionMnemonic::CMP);\n";
+		output << "\t\t\t" << dst << " = dst" << sign << "src;\n";
+		output << "\t\t\truntime.FlagsZN((int16_t)" << dst << ");\n";
+		output << "\t\t}\n";
+		break;
+	}
+	}
+}
+
+void Translator::EmitBranch(ostream& output, const JITInstruction& instruction, uint16_t nextPC)
+{
+	string target = Hex(BranchTarget(instruction, nextPC));
+
+	switch (instruction.code)
+	{
+	case InstructionMnemonic::JEQ:
+		output << "\t\truntime.Jump(runtime.Z() ? " << target << " : " << Hex(nextPC) << ");\n";
+		break;
+	case InstructionMnemonic::JNE:
+		output << "\t\truntime.Jump(!runtime.Z() ? " << target << " : " << Hex(nextPC) << ");\n";
+		break;
+	case InstructionMnemonic::JGT:
+		output << "\t\truntime.Jump((runtime.N() ^ runtime.O()) == 0 ? " << target << " : " << Hex(nextPC) << ");\n";
+		break;
+	default:
+		output << "\t\truntime.Jump(" << target << ");\n";
+		break;
+	}
+}
+
+void Translator::EmitImage(ostream& output)
+{
+	output << "static const uint8_t image[MEMORY_ADDRESS_SPACE] = {\n";
+	for (uint32_t address = 0; address < MEMORY_ADDRESS_SPACE; address += 16)
+	{
+		output << "\t";
+		for (uint32_t i = address; i < address + 16; i++)
+			output << (int)executable->memory[i] << ",";
+		output << "\n";
+	}
+	output << "};\n\n";
+
+	output << "static const AOTSection sections[] = {\n";
+	LinkerSections::const_iterator it;
+	for (it = executable->sectionStartMap.begin(); it != executable->sectionStartMap.end(); it++)
+	{
+		const SectionTableEntry* entry = executable->sectionTable->GetEntryByName(it->first);
+		if (entry)
+			output << "\t{ \"" << it->first << "\", " << Hex(it->second) << ", " << entry->length << ", " << (int)entry->flags << " },\n";
+	}
+	output << "};\n\n";
+}
+
+void Translator::EmitBlocks(ostream& output)
+{
+	map<uint16_t, vector<TranslatorInstruction>>::const_iterator it;
+	if (!blocks.empty())
+	{
+		output << "static const AOTBlock blocks[] = {\n";
+		for (it = blocks.begin(); it != blocks.end(); it++)
+		{
+			const TranslatorInstruction& last = it->second.back();
+			output << "\t{ " << Hex(it->first) << ", " << Hex(last.pc + last.instruction.length) << " },\n";
+		}
+		output << "};\n\n";
+	}
+
+	output << "static bool ExecuteBlock(AOTRuntime& runtime)\n";
+	output << "{\n";
+	output << "\tuint16_t* r = runtime.registers;\n\n";
+	output << "\tswitch (runtime.PC())\n";
+	output << "\t{\n";
+	for (it = blocks.begin(); it != blocks.end(); it++)
+	{
+		output << "\tcase " << Hex(it->first) << ":\n";
+		output << "\t\tif (!runtime.BeforeDeadline(" << it->second.size() << "))\n";
+		output << "\t\t\treturn false;\n";
+
+		bool endsWithBranch = false;
+		uint16_t nextPC = 0;
+		for (size_t i = 0; i < it->second.size(); i++)
+		{
+			const JITInstruction& instruction = it->second[i].instruction;
+			nextPC = it->second[i].pc + instruction.length;
+
+			output << "\t\t// " << Hex(it->second[i].pc) << ": " << isaTable[instruction.code].mnemonic << "\n";
+			if (JITCompiler::IsBranch(instruction))
+			{
+				EmitBranch(output, instruction, nextPC);
+				endsWithBranch = true;
+			}
+			else
+				EmitInstruction(output, instruction, nextPC);
+		}
+
+		if (!endsWithBranch)
+			output << "\t\truntime.Jump(" << Hex(nextPC) << ");\n";
+		output << "\t\truntime.Executed(" << it->second.size() << ");\n";
+		output << "\t\treturn true;\n";
+	}
+	output << "\tdefault:\n";
+	output << "\t\treturn false;\n";
+	output << "\t}\n";
+	output << "}\n\n";
+}
+
+void Translator::Translate(const string& outputFile)
+{
+	Recover();
+
+	ofstream output(outputFile);
+	if (!output.is_open())
+		throw EmulatorException("Cannot open output file '" + outputFile + "'.", ErrorCodes::IO_OUTPUT_EXCEPTION);
+
+	output << "// Generated by translator from";
+	for (size_t i = 0; i < inputFiles.size(); i++)
+		output << " " << inputFiles[i];
+	output << ", do not edit.\n";
+	output << "// Build together with emulator sources (except main.cpp) and common library.\n\n";
+	output << "#include \"aot.h\"\n\n";
+
+	EmitImage(output);
+	EmitBlocks(output);
+
+	output << "static const AOTProgram program = {\n";
+	output << "\timage,\n";
+	output << "\tsections, sizeof(sections) / sizeof(sections[0]),\n";
+	output << "\t" << Hex(executable->initialPC) << ",\n";
+	if (blocks.empty())
+		output << "\t0, 0,\n";
+	else
+		output << "\tblocks, sizeof(blocks) / sizeof(blocks[0]),\n";
+	output << "\tExecuteBlock\n";
+	output << "};\n\n";
+
+	output << "int main()\n";
+	output << "{\n";
+	output << "\treturn AOTRuntime::Main(program);\n";
+	output << "}\n";
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef _TRANSLATOR_TRANSLATOR_H
+#define _TRANSLATOR_TRANSLATOR_H
+
+#include "../emulator/executable.h"
+#include "../emulator/jit.h"
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+#define TRANSLATOR_MAX_BLOCK_INSTRUCTIONS JIT_MAX_BLOCK_INSTRUCTIONS
+
+struct TranslatorInstruction
+{
+	uint16_t pc;
+	JITInstruction instruction;
+};
+
+// recovers code reachable from entry point and interrupt routines and writes it out
+// as C++ source; whatever cannot be analyzed statically is left to embedded interpreter
+class Translator
+{
+
+private:
+	Executable* executable;
+	vector<string> inputFiles;
+
+	// translated blocks by start address
+	map<uint16_t, vector<TranslatorInstruction>> blocks;
+	set<uint16_t> entries;
+	vector<uint16_t> worklist;
+
+	bool IsExecutable(uint32_t address, uint32_t length);
+	void AddEntry(uint32_t pc);
+	void AddSuccessors(const JITInstruction& instruction, uint16_t nextPC);
+	void RecoverBlock(uint16_t startPC);
+	void Recover();
+
+	string Source(const JITInstruction& instruction, uint16_t nextPC);
+	void EmitImage(ostream& output);
+	void EmitInstruction(ostream& output, const JITInstruction& instruction, uint16_t nextPC);
+	void EmitBranch(ostream& output, const JITInstruction& instruction, uint16_t nextPC);
+	void EmitBlocks(ostream& output);
+
+public:
+	Translator(Executable* executable, const vector<string>& inputFiles) : executable(executable), inputFiles(inputFiles) {}
+
+	void Translate(const string& outputFile);
+};
+
+#endif
\ No newline at end of file